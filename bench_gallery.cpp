@@ -0,0 +1,248 @@
+// Gallery-scaling microbenchmark for FaceGallery::recognize.
+//
+// Builds synthetic galleries of increasing size, runs a batch of queries
+// against each and prints one JSON document with per-query latency,
+// allocations per query and memory per identity.
+//
+// Usage: bench_gallery [--sizes 10,100,1000] [--queries N] [--out file.json]
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "face_gallery.hpp"
+
+using namespace cv;
+using namespace std;
+
+// ----------------- Allocation accounting -----------------
+// Heap allocations are operator new calls plus Mat buffer allocations.
+static atomic<size_t> g_allocs{0};
+static atomic<size_t> g_alloc_bytes{0};
+
+void* operator new(size_t n) {
+    g_allocs.fetch_add(1, memory_order_relaxed);
+    g_alloc_bytes.fetch_add(n, memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+
+/**
+ * @brief Counts Mat buffer allocations, which bypass operator new.
+ */
+class CountingMatAllocator : public MatAllocator {
+public:
+    explicit CountingMatAllocator(MatAllocator* b) : base(b) {}
+
+    UMatData* allocate(int dims, const int* sizes, int type, void* data, size_t* step,
+                       AccessFlag flags, UMatUsageFlags usage) const override {
+        if (!data) {
+            size_t n = CV_ELEM_SIZE(type);
+            for (int i = 0; i < dims; i++) n *= (size_t)sizes[i];
+            g_allocs.fetch_add(1, memory_order_relaxed);
+            g_alloc_bytes.fetch_add(n, memory_order_relaxed);
+        }
+        return base->allocate(dims, sizes, type, data, step, flags, usage);
+    }
+    bool allocate(UMatData* u, AccessFlag flags, UMatUsageFlags usage) const override {
+        return base->allocate(u, flags, usage);
+    }
+    void deallocate(UMatData* u) const override { base->deallocate(u); }
+
+private:
+    MatAllocator* base;
+};
+
+struct AllocSnapshot {
+    size_t count, bytes;
+    static AllocSnapshot now() { return {g_allocs.load(), g_alloc_bytes.load()}; }
+};
+
+// ----------------- Benchmark -----------------
+struct Result {
+    size_t identities = 0;
+    size_t queries = 0;
+    double build_ms = 0;
+    double bytes_per_identity = 0;
+    double mean_us = 0, p50_us = 0, p95_us = 0, p99_us = 0, max_us = 0;
+    double allocs_per_query = 0;
+    double alloc_bytes_per_query = 0;
+    size_t matched = 0;
+    double exhaustive_mean_us = 0;    ///< Same queries with coarse-to-fine disabled
+    double agreement = 0;             ///< Fraction of queries with the same answer as exhaustive
+};
+
+static Mat randomFace(RNG& rng) {
+    Mat m(FaceGallery::kFaceSize, FaceGallery::kFaceSize, CV_8UC1);
+    rng.fill(m, RNG::UNIFORM, Scalar(0), Scalar(256));
+    return m;
+}
+
+static double percentile(const vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t idx = (size_t)ceil(p * sorted.size());
+    return sorted[min(sorted.size() - 1, idx == 0 ? 0 : idx - 1)];
+}
+
+static Result runSize(size_t n, size_t queries) {
+    Result r;
+    r.identities = n;
+    RNG rng(0x5eed + n);
+
+    // Keep a few enrolled templates around to build "genuine" queries from.
+    vector<Mat> genuine;
+    FaceGallery gallery;
+    auto t0 = chrono::steady_clock::now();
+    gallery.reserve(n);
+    for (size_t i = 0; i < n; i++) {
+        ostringstream name;
+        name << "id" << setw(6) << setfill('0') << i;
+        Mat face = randomFace(rng);
+        if (genuine.size() < 16) genuine.push_back(face);
+        gallery.add(name.str(), face);
+    }
+    auto t1 = chrono::steady_clock::now();
+    r.build_ms = chrono::duration<double, milli>(t1 - t0).count();
+    // What the gallery keeps, not what building it allocated (temporaries, probe sources).
+    r.bytes_per_identity = (double)gallery.memoryBytes() / n;
+
+    // Half the queries are noisy copies of enrolled faces, half are impostors.
+    vector<Mat> probes;
+    for (size_t q = 0; q < queries; q++) {
+        if (q % 2 == 0) {
+            Mat noise(FaceGallery::kFaceSize, FaceGallery::kFaceSize, CV_8UC1);
+            rng.fill(noise, RNG::UNIFORM, Scalar(0), Scalar(8));
+            Mat probe;
+            add(genuine[(q / 2) % genuine.size()], noise, probe);
+            probes.push_back(probe);
+        } else {
+            probes.push_back(randomFace(rng));
+        }
+    }
+
+    // Exhaustive reference answers for the coarse-to-fine agreement check.
+    vector<int> reference;
+    reference.reserve(queries);
+    gallery.setCoarseToFine(0, 0);
+    auto e0 = chrono::steady_clock::now();
+    for (const Mat& probe : probes) reference.push_back(gallery.match(probe));
+    auto e1 = chrono::steady_clock::now();
+    r.exhaustive_mean_us = chrono::duration<double, micro>(e1 - e0).count() / queries;
+    gallery.setCoarseToFine(64, 8);
+
+    size_t agree = 0;
+    for (size_t q = 0; q < queries; q++)
+        if (gallery.match(probes[q]) == reference[q]) agree++;
+    r.agreement = (double)agree / queries;
+
+    vector<double> lat_us;
+    lat_us.reserve(queries);
+    AllocSnapshot q0 = AllocSnapshot::now();
+    for (const Mat& probe : probes) {
+        auto s = chrono::steady_clock::now();
+        const string& name = gallery.recognize(probe);
+        auto e = chrono::steady_clock::now();
+        lat_us.push_back(chrono::duration<double, micro>(e - s).count());
+        if (name != "Unknown") r.matched++;
+    }
+    AllocSnapshot q1 = AllocSnapshot::now();
+
+    r.queries = queries;
+    r.allocs_per_query = (double)(q1.count - q0.count) / queries;
+    r.alloc_bytes_per_query = (double)(q1.bytes - q0.bytes) / queries;
+    double total = 0;
+    for (double v : lat_us) total += v;
+    r.mean_us = total / queries;
+    sort(lat_us.begin(), lat_us.end());
+    r.p50_us = percentile(lat_us, 0.50);
+    r.p95_us = percentile(lat_us, 0.95);
+    r.p99_us = percentile(lat_us, 0.99);
+    r.max_us = lat_us.back();
+    return r;
+}
+
+static void writeJson(ostream& os, const vector<Result>& results) {
+    os << fixed << setprecision(3);
+    os << "{\n  \"benchmark\": \"recognizeFace\",\n";
+    os << "  \"opencv\": \"" << CV_VERSION << "\",\n";
+    os << "  \"template_bytes\": " << FaceGallery::kFaceSize * FaceGallery::kFaceSize << ",\n";
+    os << "  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result& r = results[i];
+        os << "    {\"identities\": " << r.identities
+           << ", \"queries\": " << r.queries
+           << ", \"matched\": " << r.matched
+           << ", \"build_ms\": " << r.build_ms
+           << ", \"bytes_per_identity\": " << r.bytes_per_identity
+           << ", \"latency_us\": {\"mean\": " << r.mean_us << ", \"p50\": " << r.p50_us
+           << ", \"p95\": " << r.p95_us << ", \"p99\": " << r.p99_us << ", \"max\": " << r.max_us << "}"
+           << ", \"allocs_per_query\": " << r.allocs_per_query
+           << ", \"alloc_bytes_per_query\": " << r.alloc_bytes_per_query
+           << ", \"exhaustive_mean_us\": " << r.exhaustive_mean_us
+           << ", \"agreement_with_exhaustive\": " << r.agreement << "}"
+           << (i + 1 < results.size() ? ",\n" : "\n");
+    }
+    os << "  ]\n}\n";
+}
+
+int main(int argc, char** argv) {
+    vector<size_t> sizes = {10, 100, 1000, 10000, 100000};
+    size_t queries = 0;   // 0 = scale with gallery size
+    string out;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool has_value = i + 1 < argc;
+        if (arg == "--sizes" && has_value) {
+            sizes.clear();
+            stringstream ss(argv[++i]);
+            string item;
+            while (getline(ss, item, ',')) sizes.push_back(stoul(item));
+        } else if (arg == "--queries" && has_value) {
+            queries = stoul(argv[++i]);
+        } else if (arg == "--out" && has_value) {
+            out = argv[++i];
+        } else {
+            cerr << "Usage: " << argv[0] << " [--sizes 10,100,...] [--queries N] [--out file.json]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    CountingMatAllocator counting(Mat::getStdAllocator());
+    Mat::setDefaultAllocator(&counting);
+
+    vector<Result> results;
+    for (size_t n : sizes) {
+        if (n == 0) continue;
+        // Keep each size to roughly the same amount of template comparisons.
+        size_t q = queries ? queries : max<size_t>(10, min<size_t>(1000, 2000000 / n));
+        cerr << "[bench] " << n << " identities, " << q << " queries\n";
+        results.push_back(runSize(n, q));
+    }
+
+    Mat::setDefaultAllocator(nullptr);
+
+    if (out.empty()) {
+        writeJson(cout, results);
+    } else {
+        ofstream file(out);
+        if (!file.is_open()) {
+            cerr << "Cannot write " << out << endl;
+            return EXIT_FAILURE;
+        }
+        writeJson(file, results);
+    }
+    return 0;
+}
@@ -0,0 +1,114 @@
+// Sum-of-squared-differences kernel benchmark.
+//
+// Checks squaredDiffSum against the scalar reference on edge-case inputs,
+// then times three ways of comparing two 200x200 templates:
+//   three_pass : absdiff + CV_8U mul + sum (the original recognizeFace code,
+//                which also saturates every squared difference at 255)
+//   scalar     : squaredDiffSumScalar
+//   kernel     : squaredDiffSum (universal intrinsics when available)
+// and prints the result as JSON.
+//
+// Usage: bench_ssd [--iters N]
+
+#include <opencv2/opencv.hpp>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "face_gallery.hpp"
+#include "ssd.hpp"
+
+using namespace cv;
+using namespace std;
+
+/**
+ * @brief Compare the kernel with the scalar reference; returns mismatch count.
+ */
+static int verifyKernel() {
+    RNG rng(12345);
+    int failures = 0;
+    vector<size_t> lengths;
+    for (size_t n = 0; n <= 257; n++) lengths.push_back(n);
+    lengths.push_back(FaceGallery::kTemplateBytes);
+    lengths.push_back(1 << 20);   // several flush blocks on every vector width
+
+    for (size_t n : lengths) {
+        // Unaligned start (+1) to exercise unaligned loads.
+        vector<uchar> a(n + 1), b(n + 1);
+        for (int pattern = 0; pattern < 3; pattern++) {
+            for (size_t i = 0; i < n + 1; i++) {
+                if (pattern == 0) { a[i] = (uchar)rng.uniform(0, 256); b[i] = (uchar)rng.uniform(0, 256); }
+                else if (pattern == 1) { a[i] = 255; b[i] = 0; }          // worst case for overflow
+                else { a[i] = 0; b[i] = 255; }
+            }
+            uint64_t ref = squaredDiffSumScalar(a.data() + 1, b.data() + 1, n);
+            uint64_t got = squaredDiffSum(a.data() + 1, b.data() + 1, n);
+            if (ref != got) {
+                cerr << "[verify] mismatch n=" << n << " pattern=" << pattern
+                     << " ref=" << ref << " kernel=" << got << "\n";
+                failures++;
+            }
+        }
+    }
+    return failures;
+}
+
+template <class F>
+static double nsPerCall(int iters, F&& f) {
+    auto t0 = chrono::steady_clock::now();
+    for (int i = 0; i < iters; i++) f();
+    auto t1 = chrono::steady_clock::now();
+    return chrono::duration<double, nano>(t1 - t0).count() / iters;
+}
+
+int main(int argc, char** argv) {
+    int iters = 20000;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg == "--iters" && i + 1 < argc) iters = max(1, atoi(argv[++i]));
+        else {
+            cerr << "Usage: " << argv[0] << " [--iters N]\n";
+            return EXIT_FAILURE;
+        }
+    }
+
+    int failures = verifyKernel();
+    if (failures) {
+        cerr << "[verify] " << failures << " mismatches\n";
+        return EXIT_FAILURE;
+    }
+
+    const int S = FaceGallery::kFaceSize;
+    RNG rng(42);
+    Mat a(S, S, CV_8UC1), b(S, S, CV_8UC1);
+    rng.fill(a, RNG::UNIFORM, Scalar(0), Scalar(256));
+    rng.fill(b, RNG::UNIFORM, Scalar(0), Scalar(256));
+
+    volatile double sink = 0;
+    double three_pass = nsPerCall(iters, [&] {
+        Mat diff;
+        absdiff(a, b, diff);
+        sink = sink + sum(diff.mul(diff))[0];
+    });
+    double scalar = nsPerCall(iters, [&] {
+        sink = sink + (double)squaredDiffSumScalar(a.ptr<uchar>(), b.ptr<uchar>(), (size_t)S * S);
+    });
+    double kernel = nsPerCall(iters, [&] {
+        sink = sink + (double)squaredDiffSum(a.ptr<uchar>(), b.ptr<uchar>(), (size_t)S * S);
+    });
+
+    cout << fixed << setprecision(1);
+    cout << "{\n  \"benchmark\": \"ssd\",\n";
+    cout << "  \"opencv\": \"" << CV_VERSION << "\",\n";
+    cout << "  \"bytes\": " << S * S << ",\n";
+    cout << "  \"iters\": " << iters << ",\n";
+    cout << "  \"ns_per_template\": {\"three_pass\": " << three_pass
+         << ", \"scalar\": " << scalar << ", \"kernel\": " << kernel << "},\n";
+    cout << setprecision(2);
+    cout << "  \"speedup_vs_three_pass\": " << three_pass / kernel << ",\n";
+    cout << "  \"speedup_vs_scalar\": " << scalar / kernel << "\n}\n";
+    return 0;
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "face_gallery.hpp"
+#include "vote_window.hpp"
+
+/**
+ * @struct EngineConfig
+ * @brief Run-time settings of the attendance engine.
+ *
+ * Every field has a key; on the command line it is given as `--key value`,
+ * in a config file (`--config <file>`) as a `key = value` line.
+ */
+struct EngineConfig {
+    std::string photos = "photos";                                   ///< photos: enrollment directory
+    std::string gallery_cache = "gallery.bin";                       ///< gallery-cache: extracted-template cache file ("" = off)
+    bool watch_photos = false;                                       ///< watch-photos: re-enroll when the photos directory changes
+    int enroll_threads = 0;                                          ///< enroll-threads: threads extracting enrollment photos (0 = all cores)
+    int coarse_keep = 64;                                            ///< coarse-keep: templates kept by the 25x25 matching pass (0 = exhaustive matching)
+    int mid_keep = 8;                                                ///< mid-keep: templates kept by the 50x50 matching pass
+    int match_topk = 1;                                              ///< match-topk: identity score = mean MSE of its best K templates (1 = best template)
+    std::string cascade = "haarcascade_frontalface_default.xml";     ///< cascade: Haar cascade XML
+    std::string attendance = "attendance.csv";                       ///< attendance: CSV output
+    std::string replay;                                              ///< replay: video file or frame directory
+    std::string source = "0";                                        ///< source: frame source spec (see FrameSource::open)
+    int source_width = 0;                                            ///< source-width: camera request / raw frame width
+    int source_height = 0;                                           ///< source-height: camera request / raw frame height
+    double source_fps = 0;                                           ///< source-fps: camera request / image directory replay rate
+    std::string cameras;                                             ///< cameras: comma-separated source specs served by one process
+    int workers = 0;                                                 ///< workers: processing threads shared by all cameras (0 = auto)
+    int detect_interval = 1;                                         ///< detect-every: frames between full detections (1 = no tracking)
+    double detect_scale = 1.0;                                       ///< detect-scale: downscale factor of the frame given to the cascade
+    double motion_threshold = 0.0;                                   ///< motion-threshold: min 64x36 mean abs diff to process a frame (0 = off)
+    int recognize_every = 1;                                         ///< recognize-every: frames a track's recognized name is reused (1 = scan every frame)
+    double recognize_change = 8.0;                                   ///< recognize-change: 8x8 thumbnail mean abs diff that forces a new scan
+    int verify_votes = 0;                                            ///< verify-votes: k-of-n verification, K agreeing frames (0 = 3 s without interruption)
+    double verify_window = 3.0;                                      ///< verify-window: ...within the last T seconds
+    bool pipeline = false;                                           ///< pipeline: run capture/detect/recognize/render on separate threads
+    bool latest_frame = false;                                       ///< latest-frame: drain the camera on its own thread, drop stale frames
+    bool headless = false;                                           ///< headless: no menu, no GUI; run until SIGINT/SIGTERM
+
+    /**
+     * @brief Set one field by key.
+     * @return false if the key is unknown or the value is invalid.
+     */
+    bool set(const std::string& key, const std::string& value) {
+        try {
+            if (key == "photos") photos = value;
+            else if (key == "gallery-cache") gallery_cache = value;
+            else if (key == "watch-photos") return parseBool(value, watch_photos);
+            else if (key == "enroll-threads") return parseInt(value, 0, enroll_threads);
+            else if (key == "coarse-keep") return parseInt(value, 0, coarse_keep) && coarse_keep <= (int)FaceGallery::kMaxKeep;
+            else if (key == "mid-keep") return parseInt(value, 1, mid_keep) && mid_keep <= (int)FaceGallery::kMaxKeep;
+            else if (key == "match-topk") return parseInt(value, 1, match_topk) && match_topk <= (int)FaceGallery::kMaxTopK;
+            else if (key == "cascade") cascade = value;
+            else if (key == "attendance") attendance = value;
+            else if (key == "replay") replay = value;
+            else if (key == "source") source = value;
+            else if (key == "source-width") return parseInt(value, 0, source_width);
+            else if (key == "source-height") return parseInt(value, 0, source_height);
+            else if (key == "source-fps") return parseDouble(value, 0.0, source_fps);
+            else if (key == "config") return load(value);
+            else if (key == "cameras") cameras = value;
+            else if (key == "workers") return parseInt(value, 0, workers);
+            else if (key == "detect-every") return parseInt(value, 1, detect_interval);
+            else if (key == "detect-scale") return parseDouble(value, 1.0, detect_scale);
+            else if (key == "motion-threshold") return parseDouble(value, 0.0, motion_threshold);
+            else if (key == "recognize-every") return parseInt(value, 1, recognize_every);
+            else if (key == "recognize-change") return parseDouble(value, 0.0, recognize_change);
+            else if (key == "verify-votes") return parseInt(value, 0, verify_votes) && verify_votes <= (int)VoteWindow::kCapacity;
+            else if (key == "verify-window") return parsePositive(value, verify_window);
+            else if (key == "pipeline") return parseBool(value, pipeline);
+            else if (key == "latest-frame") return parseBool(value, latest_frame);
+            else if (key == "headless") return parseBool(value, headless);
+            else return false;
+        } catch (const std::exception&) {
+            return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Apply a file of `key = value` lines; blank lines and `#` comments are ignored.
+     * @return false (after printing the offending line) on a read error or a bad entry.
+     */
+    bool load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            std::cerr << "Cannot read config file: " << path << std::endl;
+            return false;
+        }
+        std::string line;
+        int line_no = 0;
+        while (std::getline(file, line)) {
+            line_no++;
+            std::string entry = trim(line.substr(0, line.find('#')));
+            if (entry.empty()) continue;
+            size_t eq = entry.find('=');
+            if (eq == std::string::npos || !set(trim(entry.substr(0, eq)), trim(entry.substr(eq + 1)))) {
+                std::cerr << path << ":" << line_no << ": invalid setting: " << line << std::endl;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief The entries of cameras, trimmed, empty ones dropped.
+     */
+    std::vector<std::string> cameraList() const {
+        std::vector<std::string> specs;
+        size_t begin = 0;
+        while (begin <= cameras.size()) {
+            size_t end = cameras.find(',', begin);
+            if (end == std::string::npos) end = cameras.size();
+            std::string spec = trim(cameras.substr(begin, end - begin));
+            if (!spec.empty()) specs.push_back(spec);
+            begin = end + 1;
+        }
+        return specs;
+    }
+
+    static const char* usage() {
+        return "  --config <file>         read 'key = value' settings (keys as below, without --)\n"
+               "  --photos <dir>          enrollment photos (default: photos)\n"
+               "  --gallery-cache <file>  cache of extracted templates, \"\" to disable (default: gallery.bin)\n"
+               "  --watch-photos <on|off> add, update and drop identities live as photos change (Linux)\n"
+               "  --enroll-threads <N>    threads extracting enrollment photos (default: all cores)\n"
+               "  --coarse-keep <N>       large galleries: candidates kept after the 25x25 pass, 0 = always exhaustive (max 64; default: 64)\n"
+               "  --mid-keep <N>          ...and after the 50x50 pass (max 64; default: 8)\n"
+               "  --match-topk <K>        score a person with several photos by the mean of their best K (max 16; default: 1)\n"
+               "  --cascade <xml>         Haar cascade file\n"
+               "  --attendance <csv>      attendance output (default: attendance.csv)\n"
+               "  --replay <source>       replay footage headless and print a benchmark\n"
+               "  --source <spec>         frame source: <index>, camera:<index|/dev/videoN>, file:<video>,\n"
+               "                          dir:<images>, raw:<fifo|-> (default: 0)\n"
+               "  --source-width <px>     requested camera width / raw frame width\n"
+               "  --source-height <px>    requested camera height / raw frame height\n"
+               "  --source-fps <f>        requested camera rate / image directory replay rate (0 = max)\n"
+               "  --cameras <a,b,...>     serve several sources from one process (headless, shared gallery)\n"
+               "  --workers <N>           processing threads shared by all cameras (default: one per camera, max #cores)\n"
+               "  --detect-every <N>      run Haar detection every N frames and track in between\n"
+               "  --detect-scale <f>      downscale frames by f (>= 1) before Haar detection\n"
+               "  --motion-threshold <e>  skip static frames whose 64x36 mean abs diff is below e\n"
+               "  --recognize-every <N>   reuse a track's recognized name for up to N frames\n"
+               "  --recognize-change <d>  ...unless its 8x8 thumbnail changed by more than d (default: 8)\n"
+               "  --verify-votes <K>      verify a face once K frames agree on its name (max 128; default: 3 s uninterrupted)\n"
+               "  --verify-window <T>     ...within the last T > 0 seconds (default: 3)\n"
+               "  --pipeline <on|off>     run capture, detection, recognition and display on separate threads\n"
+               "  --latest-frame <on|off> always process the newest camera frame, dropping stale ones\n"
+               "  --headless <on|off>     run without menu or window until SIGINT/SIGTERM (SIGUSR1 prints stats)\n";
+    }
+
+private:
+    static std::string trim(const std::string& s) {
+        size_t b = s.find_first_not_of(" \t\r");
+        size_t e = s.find_last_not_of(" \t\r");
+        return b == std::string::npos ? std::string() : s.substr(b, e - b + 1);
+    }
+
+    static bool parseInt(const std::string& value, int min_value, int& out) {
+        size_t used = 0;
+        int v = std::stoi(value, &used);
+        if (used != value.size() || v < min_value) return false;
+        out = v;
+        return true;
+    }
+
+    static bool parseBool(const std::string& value, bool& out) {
+        if (value == "1" || value == "on" || value == "true" || value == "yes") out = true;
+        else if (value == "0" || value == "off" || value == "false" || value == "no") out = false;
+        else return false;
+        return true;
+    }
+
+    static bool parseDouble(const std::string& value, double min_value, double& out) {
+        size_t used = 0;
+        double v = std::stod(value, &used);
+        if (used != value.size() || !(v >= min_value)) return false;
+        out = v;
+        return true;
+    }
+
+    static bool parsePositive(const std::string& value, double& out) {
+        double v = 0;
+        if (!parseDouble(value, 0.0, v) || v <= 0) return false;
+        out = v;
+        return true;
+    }
+};
@@ -0,0 +1,462 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <array>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "ssd.hpp"
+
+/**
+ * @class FaceGallery
+ * @brief In-memory set of enrolled face templates and the matcher over them.
+ *
+ * Templates are 200x200 equalized grayscale crops as produced by
+ * AttendanceSystem::extractFace. They are stored structure-of-arrays style:
+ * one contiguous N x kTemplateBytes CV_8U matrix (rows are 64-byte aligned
+ * because kTemplateBytes is a multiple of 64) and a parallel vector of
+ * identities. An identity may have any number of templates (one per photo);
+ * it is scored by its best template, or by the mean of its best score_topk.
+ * Matching is a single streaming pass over that matrix and does not allocate.
+ * MSE is computed exactly (see squaredDiffSum in ssd.hpp).
+ *
+ * Every identity with more than one template also keeps the mean of its
+ * templates (its centroid) and a bound on how far its templates are from
+ * it (its radius). By the triangle inequality no template of the identity can be closer to a
+ * probe than |probe - centroid| - radius, so one comparison with the
+ * centroid can rule out the whole identity without changing the result.
+ *
+ * For large galleries matching is coarse-to-fine: every template also keeps a
+ * 25x25 and a 50x50 box-averaged copy. All templates are ranked at 25x25,
+ * the best coarse_keep are re-ranked at 50x50, and only the identities of the
+ * best mid_keep reach the full-resolution comparison. This can miss the true
+ * match, so it is used only for galleries of more than kPyramidMinRatio x
+ * coarse_keep templates; below that it would not save enough to pay for it.
+ */
+class FaceGallery {
+public:
+    static constexpr int kFaceSize = 200;                            ///< Template width and height
+    static constexpr int kTemplateBytes = kFaceSize * kFaceSize;     ///< Bytes per template row
+    static constexpr double kMatchThreshold = 1500.0;                ///< Maximum MSE accepted as a match
+    static constexpr int kAbandonBlockRows = 8;                      ///< Rows compared between early-abandon checks
+    static constexpr int kAbandonBlockBytes = kAbandonBlockRows * kFaceSize;
+    static constexpr int kCoarseSize = 25;                           ///< Side of the coarsest pyramid level
+    static constexpr int kMidSize = 50;                              ///< Side of the middle pyramid level
+    static constexpr int kCoarseBytes = kCoarseSize * kCoarseSize;
+    static constexpr int kMidBytes = kMidSize * kMidSize;
+    static constexpr size_t kMaxKeep = 64;                           ///< Upper bound for coarse_keep / mid_keep
+    static constexpr size_t kPyramidMinRatio = 8;                    ///< Coarse-to-fine only above this many x coarse_keep templates
+    static constexpr size_t kMaxTopK = 16;                           ///< Upper bound for score_topk
+
+    /**
+     * @brief Add a template to an identity (a new one if the name is new).
+     * @param face kFaceSize x kFaceSize CV_8UC1 image.
+     */
+    void add(const std::string& name, const cv::Mat& face) {
+        CV_Assert(face.type() == CV_8UC1 && face.rows == kFaceSize && face.cols == kFaceSize);
+        cv::Mat row = (face.isContinuous() ? face : face.clone()).reshape(1, 1);
+
+        cv::Mat coarse_row(1, kCoarseBytes, CV_8UC1), mid_row(1, kMidBytes, CV_8UC1);
+        pyramid(row.ptr<uchar>(), coarse_row.ptr<uchar>(), mid_row.ptr<uchar>());
+
+        templates.push_back(row);
+        coarse.push_back(coarse_row);
+        mid.push_back(mid_row);
+        int id = addRow(name);
+        if (members[id].size() > 1) extendCentroid(id);
+    }
+
+    /**
+     * @brief Replace the contents with rows stored elsewhere, such as a
+     *        memory-mapped gallery cache, without copying them.
+     *        Rows with the same name become templates of one identity;
+     *        identities are numbered in order of their first row.
+     * @param templ N x kTemplateBytes CV_8UC1; coarse_rows and mid_rows likewise.
+     * @param centroid_rows C x kTemplateBytes CV_8UC1, as from centroid().
+     * @param centroid_of Per identity: row in centroid_rows, -1 for one template.
+     * @param radii Per identity, as from radiusOf().
+     * @param backing Owner of the row memory, kept alive with the gallery.
+     * @return false (and the gallery empty) if the centroid data does not fit the rows.
+     */
+    bool adopt(const cv::Mat& templ, const cv::Mat& coarse_rows, const cv::Mat& mid_rows,
+               const std::vector<std::string>& row_names, const cv::Mat& centroid_rows,
+               std::vector<int> centroid_of, std::vector<double> radii, std::shared_ptr<const void> backing) {
+        CV_Assert(templ.rows == (int)row_names.size() && templ.cols == kTemplateBytes &&
+                  coarse_rows.rows == templ.rows && coarse_rows.cols == kCoarseBytes &&
+                  mid_rows.rows == templ.rows && mid_rows.cols == kMidBytes &&
+                  (centroid_rows.empty() || centroid_rows.cols == kTemplateBytes));
+        clear();
+        for (const std::string& n : row_names) addRow(n);
+        bool fits = centroid_of.size() == names.size() && radii.size() == names.size();
+        for (size_t id = 0; fits && id < names.size(); id++)
+            fits = members[id].size() > 1 ? centroid_of[id] >= 0 && centroid_of[id] < centroid_rows.rows
+                                          : centroid_of[id] == -1;
+        if (!fits) {
+            clear();
+            return false;
+        }
+        templates = templ;
+        coarse = coarse_rows;
+        mid = mid_rows;
+        centroids = centroid_rows;
+        centroid_row = std::move(centroid_of);
+        radius = std::move(radii);
+        external = std::move(backing);
+        return true;
+    }
+
+    /**
+     * @brief Compute the 25x25 and 50x50 pyramid levels of a kFaceSize x kFaceSize template.
+     */
+    static void pyramid(const uchar* face, uchar* coarse_out, uchar* mid_out) {
+        boxDownsample(face, kFaceSize / kCoarseSize, coarse_out);
+        boxDownsample(face, kFaceSize / kMidSize, mid_out);
+    }
+
+    /**
+     * @brief Configure how many candidates survive each pyramid level.
+     * @param coarse_n Kept after the 25x25 ranking; 0 disables coarse-to-fine
+     *                 matching (every template is compared at full resolution).
+     *                 Galleries of at most kPyramidMinRatio x coarse_n
+     *                 templates are always matched exhaustively.
+     * @param mid_n Kept after the 50x50 ranking.
+     */
+    void setCoarseToFine(size_t coarse_n, size_t mid_n) {
+        coarse_keep = std::min(coarse_n, kMaxKeep);
+        mid_keep = std::max<size_t>(1, std::min(mid_n, coarse_keep ? coarse_keep : kMaxKeep));
+    }
+
+    /**
+     * @brief Configure how an identity with several templates is scored.
+     * @param topk 1: MSE of its best template; k > 1: mean MSE of its best k
+     *             templates (all of them if it has fewer).
+     */
+    void setScoring(size_t topk) { score_topk = std::max<size_t>(1, std::min(topk, kMaxTopK)); }
+
+    /**
+     * @brief Pre-size storage for n templates to avoid regrowth while loading.
+     */
+    void reserve(size_t n) {
+        if (n == 0) return;
+        reserveRows(templates, n, kTemplateBytes);
+        reserveRows(coarse, n, kCoarseBytes);
+        reserveRows(mid, n, kMidBytes);
+        row_identity.reserve(n);
+    }
+
+    /**
+     * @brief Memory held by the gallery: template rows (including reserved
+     *        capacity), pyramid levels, centroids and the identity index.
+     */
+    size_t memoryBytes() const {
+        size_t n = heldBytes(templates) + heldBytes(coarse) + heldBytes(mid) + heldBytes(centroids);
+        n += names.capacity() * sizeof(std::string) + members.capacity() * sizeof(std::vector<int>);
+        for (size_t id = 0; id < names.size(); id++)
+            n += members[id].capacity() * sizeof(int) + (names[id].capacity() > 15 ? names[id].capacity() + 1 : 0);
+        n += (row_identity.capacity() + centroid_row.capacity()) * sizeof(int) + radius.capacity() * sizeof(double);
+        n += sum.capacity() * sizeof(uint32_t);
+        n += index.bucket_count() * sizeof(void*) + index.size() * (sizeof(std::pair<const std::string, int>) + sizeof(void*));
+        return n;
+    }
+
+    /** @brief Number of identities. */
+    size_t size() const { return names.size(); }
+    /** @brief Number of templates (all identities). */
+    size_t templateCount() const { return row_identity.size(); }
+    bool empty() const { return names.empty(); }
+    void clear() {
+        templates.release();
+        coarse.release();
+        mid.release();
+        centroids.release();
+        names.clear();
+        members.clear();
+        row_identity.clear();
+        centroid_row.clear();
+        radius.clear();
+        index.clear();
+        sum.clear();
+        sum_id = -1;
+        external.reset();
+    }
+
+    const std::string& name(size_t i) const { return names[i]; }
+    const uchar* data(size_t row) const { return templates.ptr<uchar>((int)row); }
+
+    /** @brief Centroid of identity i, nullptr if it has a single template. */
+    const uchar* centroid(size_t i) const {
+        return centroid_row[i] < 0 ? nullptr : centroids.ptr<uchar>(centroid_row[i]);
+    }
+    /** @brief Upper bound on the distance (sqrt SSD) of identity i's templates from its centroid. */
+    double radiusOf(size_t i) const { return radius[i]; }
+
+    /**
+     * @brief Index of the best matching identity by mean squared error.
+     *
+     * Full-resolution comparisons go kAbandonBlockRows rows at a time, and a
+     * template is abandoned as soon as its partial SSD can no longer beat
+     * both the best match so far and kMatchThreshold. An identity with
+     * several templates is first compared with its centroid and skipped if
+     * none of its templates can beat that bound. When the gallery has more
+     * than kPyramidMinRatio x coarse_keep templates, only the identities of
+     * the coarse-to-fine survivors (plus the hint) are compared at full
+     * resolution.
+     *
+     * @param face kFaceSize x kFaceSize CV_8UC1 image.
+     * @param out_mse Optional: score (MSE) of the returned match.
+     * @param hint Identity to try first (e.g. the last match) so that a tight
+     *             bound is known early; -1 for none.
+     * @return Identity index, or -1 if nothing is under kMatchThreshold.
+     */
+    int match(const cv::Mat& face, double* out_mse = nullptr, int hint = -1) const {
+        CV_Assert(face.type() == CV_8UC1 && face.rows == kFaceSize && face.cols == kFaceSize);
+        cv::Mat probe = face.isContinuous() ? face : face.clone();
+        const uchar* q = probe.ptr<uchar>();
+
+        // Score must stay strictly below this to win (threshold, then best so far).
+        uint64_t bound = (uint64_t)std::ceil(kMatchThreshold * kTemplateBytes);
+        int best = -1;
+
+        auto consider = [&](int id) {
+            const std::vector<int>& rows = members[id];
+            if (rows.size() > 1) {
+                // Every template is at least |q - c| - radius away: prune if that reaches the bound.
+                double reach = std::sqrt((double)bound) + radius[id];
+                uint64_t d = ssdUpTo(q, centroids.ptr<uchar>(centroid_row[id]), (uint64_t)std::ceil(reach * reach));
+                double lower = std::sqrt((double)d) - radius[id];
+                if (lower > 0 && lower * lower >= (double)bound) return;
+            }
+            uint64_t score;
+            if (score_topk == 1) {
+                score = UINT64_MAX;
+                for (int r : rows) score = std::min(score, ssdUpTo(q, data(r), std::min(score, bound)));
+            } else {
+                // The k smallest SSDs; a template is abandoned once it cannot enter them.
+                std::array<uint64_t, kMaxTopK> smallest;
+                size_t k = std::min(score_topk, rows.size()), n = 0;
+                for (int r : rows) {
+                    uint64_t s = ssdUpTo(q, data(r), n == k ? smallest[k - 1] : UINT64_MAX);
+                    if (n == k && s >= smallest[k - 1]) continue;
+                    size_t pos = n < k ? n++ : k - 1;
+                    while (pos > 0 && smallest[pos - 1] > s) {
+                        smallest[pos] = smallest[pos - 1];
+                        pos--;
+                    }
+                    smallest[pos] = s;
+                }
+                uint64_t sum = 0;
+                for (size_t j = 0; j < k; j++) sum += smallest[j];
+                score = sum / k;
+            }
+            if (score < bound) {
+                bound = score;
+                best = id;
+            }
+        };
+
+        if (hint >= 0 && (size_t)hint < names.size()) consider(hint);
+
+        if (coarse_keep == 0 || row_identity.size() <= kPyramidMinRatio * coarse_keep) {
+            for (size_t id = 0; id < names.size(); id++)
+                if ((int)id != hint) consider((int)id);
+        } else {
+            uchar qc[kCoarseBytes], qm[kMidBytes];
+            boxDownsample(q, kFaceSize / kCoarseSize, qc);
+            boxDownsample(q, kFaceSize / kMidSize, qm);
+
+            TopK coarse_best(coarse_keep);
+            for (size_t i = 0; i < row_identity.size(); i++)
+                coarse_best.push(squaredDiffSum(qc, coarse.ptr<uchar>((int)i), kCoarseBytes), (int)i);
+
+            TopK mid_best(mid_keep);
+            for (size_t k = 0; k < coarse_best.count; k++) {
+                int i = coarse_best.items[k].second;
+                mid_best.push(squaredDiffSum(qm, mid.ptr<uchar>(i), kMidBytes), i);
+            }
+
+            // Each surviving identity once, in rank order of its best template.
+            std::array<int, kMaxKeep> seen;
+            size_t n_seen = 0;
+            for (size_t k = 0; k < mid_best.count; k++) {
+                int id = row_identity[mid_best.items[k].second];
+                if (id == hint || std::find(seen.begin(), seen.begin() + n_seen, id) != seen.begin() + n_seen)
+                    continue;
+                seen[n_seen++] = id;
+                consider(id);
+            }
+        }
+
+        if (out_mse) *out_mse = best < 0 ? DBL_MAX : (double)bound / kTemplateBytes;
+        return best;
+    }
+
+    /**
+     * @brief Recognize a face by comparing with known faces using mean squared error.
+     * @param hint See match().
+     * @return Best matching name, or "Unknown" if nothing is under the threshold.
+     */
+    const std::string& recognize(const cv::Mat& face, int hint = -1) const {
+        static const std::string unknown = "Unknown";
+        int best = match(face, nullptr, hint);
+        return best < 0 ? unknown : names[best];
+    }
+
+private:
+    cv::Mat templates;                                  ///< N x kTemplateBytes, one template per row
+    cv::Mat coarse;                                     ///< N x kCoarseBytes, 25x25 level per row
+    cv::Mat mid;                                        ///< N x kMidBytes, 50x50 level per row
+    cv::Mat centroids;                                  ///< Rounded mean template of each multi-template identity
+    size_t coarse_keep = 64;                            ///< Survivors of the 25x25 ranking (0 = exhaustive)
+    size_t mid_keep = 8;                                ///< Survivors of the 50x50 ranking
+    size_t score_topk = 1;                              ///< Templates averaged into an identity's score
+    std::vector<std::string> names;                     ///< Name of each identity
+    std::vector<std::vector<int>> members;              ///< Template rows of each identity
+    std::vector<int> row_identity;                      ///< Identity of each template row
+    std::vector<int> centroid_row;                      ///< Row in centroids per identity, -1 if it has one template
+    std::vector<double> radius;                         ///< Bound on the distance (sqrt SSD) of any template from the centroid
+    std::vector<uint32_t> sum;                          ///< Running pixel sums of identity sum_id, used while enrolling
+    int sum_id = -1;                                    ///< Identity whose templates sum holds, -1 for none
+    std::unordered_map<std::string, int> index;         ///< Name -> identity, used only while enrolling
+    std::shared_ptr<const void> external;               ///< Owner of adopted row storage, if any
+
+    /**
+     * @brief Register the newest template row under name.
+     * @return Its identity.
+     */
+    int addRow(const std::string& name) {
+        auto it = index.find(name);
+        int id;
+        if (it != index.end()) {
+            id = it->second;
+        } else {
+            id = (int)names.size();
+            index.emplace(name, id);
+            names.push_back(name);
+            members.emplace_back();
+            centroid_row.push_back(-1);
+            radius.push_back(0.0);
+        }
+        members[id].push_back((int)row_identity.size());
+        row_identity.push_back(id);
+        return id;
+    }
+
+    /**
+     * @brief Move an identity's centroid to the mean of its templates after
+     *        its newest template was added, in time independent of how many
+     *        it has.
+     *
+     * Pixel sums are kept for the identity being enrolled. Enrollment goes in
+     * path order, so an identity's photos normally arrive together and the
+     * sums are rebuilt only when another identity is extended in between.
+     * The radius is not recomputed over all templates: the old templates
+     * were within radius of the old centroid, so they are within radius +
+     * |old - new centroid| of the new one. This bound can be a little loose,
+     * which only costs pruning, never correctness.
+     */
+    void extendCentroid(int id) {
+        const std::vector<int>& rows = members[id];
+        const uchar* t = data(rows.back());
+        if (sum_id != id) {
+            sum.assign(kTemplateBytes, 0);
+            for (int r : rows) {
+                const uchar* p = data(r);
+                for (int j = 0; j < kTemplateBytes; j++) sum[j] += p[j];
+            }
+            sum_id = id;
+        } else {
+            for (int j = 0; j < kTemplateBytes; j++) sum[j] += t[j];
+        }
+
+        // A single template is its own centroid, at radius 0.
+        cv::Mat old_c(1, kTemplateBytes, CV_8UC1);
+        const uchar* prev = centroid_row[id] < 0 ? data(rows[0]) : centroids.ptr<uchar>(centroid_row[id]);
+        std::copy(prev, prev + kTemplateBytes, old_c.ptr<uchar>());
+        if (centroid_row[id] < 0) {
+            centroid_row[id] = centroids.rows;
+            centroids.push_back(cv::Mat(1, kTemplateBytes, CV_8UC1));
+        }
+        uchar* c = centroids.ptr<uchar>(centroid_row[id]);
+        const uint32_t n = (uint32_t)rows.size();
+        for (int j = 0; j < kTemplateBytes; j++) c[j] = (uchar)((sum[j] + n / 2) / n);
+
+        double shift = std::sqrt((double)squaredDiffSum(old_c.ptr<uchar>(), c, kTemplateBytes));
+        double newest = std::sqrt((double)squaredDiffSum(t, c, kTemplateBytes));
+        radius[id] = std::ceil(std::max(radius[id] + shift, newest));
+    }
+
+    /**
+     * @brief SSD of two templates, kAbandonBlockRows rows at a time; stops
+     *        early with a partial sum >= limit once it reaches limit.
+     */
+    static uint64_t ssdUpTo(const uchar* a, const uchar* b, uint64_t limit) {
+        uint64_t partial = 0;
+        for (size_t off = 0; off < (size_t)kTemplateBytes; off += kAbandonBlockBytes) {
+            partial += squaredDiffSum(a + off, b + off, kAbandonBlockBytes);
+            if (partial >= limit) break;
+        }
+        return partial;
+    }
+
+    /**
+     * @brief Fixed-capacity list of the k smallest (score, index) pairs, sorted ascending.
+     */
+    struct TopK {
+        std::array<std::pair<uint64_t, int>, kMaxKeep> items;
+        size_t k;
+        size_t count = 0;
+
+        explicit TopK(size_t keep) : k(keep) {}
+
+        void push(uint64_t score, int idx) {
+            if (count == k && score >= items[count - 1].first) return;
+            size_t pos = count < k ? count++ : count - 1;
+            while (pos > 0 && items[pos - 1].first > score) {
+                items[pos] = items[pos - 1];
+                pos--;
+            }
+            items[pos] = {score, idx};
+        }
+    };
+
+    /**
+     * @brief Average non-overlapping factor x factor blocks of a kFaceSize
+     *        square image (same as INTER_AREA for integer factors).
+     */
+    static void boxDownsample(const uchar* src, int factor, uchar* dst) {
+        const int out = kFaceSize / factor;
+        const int area = factor * factor;
+        for (int y = 0; y < out; y++) {
+            for (int x = 0; x < out; x++) {
+                int acc = 0;
+                for (int dy = 0; dy < factor; dy++) {
+                    const uchar* p = src + (y * factor + dy) * kFaceSize + x * factor;
+                    for (int dx = 0; dx < factor; dx++) acc += p[dx];
+                }
+                dst[y * out + x] = (uchar)((acc + area / 2) / area);
+            }
+        }
+    }
+
+    static size_t heldBytes(const cv::Mat& m) { return m.empty() ? 0 : (size_t)(m.datalimit - m.datastart); }
+
+    /**
+     * @brief Pre-size an N x cols row matrix without changing its row count.
+     */
+    static void reserveRows(cv::Mat& m, size_t n, int cols) {
+        if (m.empty()) {
+            // Mat::reserve needs a shape to grow; allocate n rows then shrink to zero.
+            m.create((int)n, cols, CV_8UC1);
+            m.resize(0);
+        } else {
+            m.reserve(n);
+        }
+    }
+};
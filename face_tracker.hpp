@@ -0,0 +1,102 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @struct FaceTrack
+ * @brief One face followed across frames.
+ */
+struct FaceTrack {
+    cv::Rect box;        ///< Current face rectangle in full-frame coordinates
+    cv::Mat templ;       ///< Appearance at kTemplSide x kTemplSide, refreshed every frame
+};
+
+/**
+ * @class FaceTracker
+ * @brief Follows detected faces between Haar detections by template matching.
+ *
+ * Each track keeps a small grayscale template of its face. On every frame the
+ * area around the previous box is scaled by the same factor and searched with
+ * normalized cross-correlation, so the cost per track does not depend on the
+ * face size.
+ */
+class FaceTracker {
+public:
+    static constexpr int kTemplSide = 32;        ///< Side of the stored appearance template
+    static constexpr double kSearchMargin = 0.5; ///< Search window grows the box by this fraction per side
+    static constexpr double kMinScore = 0.6;     ///< Below this correlation the track is lost
+
+    /**
+     * @brief Replace all tracks with fresh ones seeded from detections.
+     */
+    void reset(const cv::Mat& gray, const std::vector<cv::Rect>& detections) {
+        tracks.clear();
+        for (const cv::Rect& r : detections) {
+            FaceTrack t;
+            t.box = r;
+            cv::resize(gray(r), t.templ, cv::Size(kTemplSide, kTemplSide), 0, 0, cv::INTER_AREA);
+            tracks.push_back(t);
+        }
+    }
+
+    /**
+     * @brief Move every track to its best match in the new frame.
+     * @return false if any track was lost (it is removed).
+     */
+    bool update(const cv::Mat& gray) {
+        const cv::Rect frame_rect(0, 0, gray.cols, gray.rows);
+        bool all_found = true;
+        for (auto it = tracks.begin(); it != tracks.end();) {
+            if (follow(gray, frame_rect, *it)) {
+                ++it;
+            } else {
+                it = tracks.erase(it);
+                all_found = false;
+            }
+        }
+        return all_found;
+    }
+
+    bool empty() const { return tracks.empty(); }
+
+    /**
+     * @brief Current box of every track, in track order.
+     */
+    std::vector<cv::Rect> boxes() const {
+        std::vector<cv::Rect> out;
+        out.reserve(tracks.size());
+        for (const FaceTrack& t : tracks) out.push_back(t.box);
+        return out;
+    }
+
+private:
+    std::vector<FaceTrack> tracks;
+
+    static bool follow(const cv::Mat& gray, const cv::Rect& frame_rect, FaceTrack& t) {
+        int mx = (int)std::lround(t.box.width * kSearchMargin);
+        int my = (int)std::lround(t.box.height * kSearchMargin);
+        cv::Rect search = cv::Rect(t.box.x - mx, t.box.y - my, t.box.width + 2 * mx, t.box.height + 2 * my) & frame_rect;
+
+        double sx = (double)kTemplSide / t.box.width;
+        double sy = (double)kTemplSide / t.box.height;
+        cv::Size scaled((int)std::lround(search.width * sx), (int)std::lround(search.height * sy));
+        if (scaled.width < kTemplSide || scaled.height < kTemplSide) return false;
+
+        cv::Mat region, score;
+        cv::resize(gray(search), region, scaled, 0, 0, cv::INTER_AREA);
+        cv::matchTemplate(region, t.templ, score, cv::TM_CCOEFF_NORMED);
+        double best = 0;
+        cv::Point loc;
+        cv::minMaxLoc(score, nullptr, &best, nullptr, &loc);
+        if (best < kMinScore) return false;
+
+        // Keep the box size (it feeds the 200x200 recognition crop), clamp it into the frame.
+        t.box.x = std::clamp(search.x + (int)std::lround(loc.x / sx), 0, frame_rect.width - t.box.width);
+        t.box.y = std::clamp(search.y + (int)std::lround(loc.y / sy), 0, frame_rect.height - t.box.height);
+        region(cv::Rect(loc.x, loc.y, kTemplSide, kTemplSide)).copyTo(t.templ);
+        return true;
+    }
+};
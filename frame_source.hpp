@@ -0,0 +1,355 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <iostream>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief True if s is a non-empty string of decimal digits.
+ */
+inline bool isAllDigits(const std::string& s) {
+    return !s.empty() && std::all_of(s.begin(), s.end(), [](unsigned char c) { return std::isdigit(c) != 0; });
+}
+
+/**
+ * @struct SourceOptions
+ * @brief Capture parameters shared by all frame sources (0 = not set).
+ */
+struct SourceOptions {
+    int width = 0;       ///< Requested (camera) or actual (raw pipe) frame width
+    int height = 0;      ///< Requested (camera) or actual (raw pipe) frame height
+    double fps = 0;      ///< Requested camera rate, or replay rate of an image directory (0 = as fast as possible)
+    const std::atomic<bool>* stop = nullptr;   ///< Raised to end the stream; checked by sources that can block indefinitely
+};
+
+/**
+ * @struct FrameStamp
+ * @brief When a frame was taken.
+ *
+ * captured is on the source's own timeline: the media position for video
+ * files and the nominal frame time for image directories, so replaying at
+ * any speed gives the same times; the grab time for live sources. It drives
+ * verification and cooldown. grabbed is always the monotonic time the frame
+ * was read and is used for latency measurements.
+ */
+struct FrameStamp {
+    std::chrono::steady_clock::time_point captured;   ///< Capture time on the source timeline
+    std::chrono::steady_clock::time_point grabbed;    ///< Monotonic time the frame was read
+};
+
+/**
+ * @class FrameSource
+ * @brief Where BGR frames come from.
+ *
+ * Specs understood by open():
+ * - `camera:<index|/dev/videoN>` (a bare number also means a camera)
+ * - `file:<video>`
+ * - `dir:<directory>` image sequence in file-name order (an existing directory also works)
+ * - `raw:<fifo>` or `raw:-` for stdin, packed BGR24 frames of options.width x options.height
+ * Anything else (including stream URLs) is opened as a video file.
+ */
+class FrameSource {
+public:
+    virtual ~FrameSource() = default;
+
+    /**
+     * @brief Read the next frame.
+     * @param stamp Set to the capture and grab time of the frame.
+     * @return false at end of stream (a camera that stops delivering frames also ends).
+     */
+    virtual bool read(cv::Mat& frame, FrameStamp& stamp) = 0;
+
+    /**
+     * @brief Make a read() that is blocked, or any later one, return false
+     *        soon. Safe to call from another thread.
+     */
+    virtual void cancel() {}
+
+    /// A live feed: its end is a failure, not the end of the footage.
+    virtual bool live() const { return false; }
+
+    /// Human-readable description for logs.
+    virtual std::string describe() const = 0;
+
+    /**
+     * @brief Create a source from a spec string.
+     * @return nullptr (after printing the reason) if it cannot be opened.
+     */
+    static std::unique_ptr<FrameSource> open(const std::string& spec, const SourceOptions& opts);
+};
+
+/**
+ * @brief Live camera by index or device path, with requested size and rate.
+ */
+class CameraSource : public FrameSource {
+public:
+    CameraSource(const std::string& device, const SourceOptions& opts) : name(device) {
+        bool is_index = isAllDigits(device);
+#ifdef __linux__
+        const int api = cv::CAP_V4L2;
+#else
+        const int api = cv::CAP_ANY;
+#endif
+        if (is_index) cap.open(std::stoi(device), api);
+        else cap.open(device, api);
+        if (!cap.isOpened()) return;
+        if (opts.width > 0) cap.set(cv::CAP_PROP_FRAME_WIDTH, opts.width);
+        if (opts.height > 0) cap.set(cv::CAP_PROP_FRAME_HEIGHT, opts.height);
+        if (opts.fps > 0) cap.set(cv::CAP_PROP_FPS, opts.fps);
+    }
+
+    bool isOpened() const { return cap.isOpened(); }
+
+    bool read(cv::Mat& frame, FrameStamp& stamp) override {
+        // A camera may hiccup for a few frames; only a long run of failures ends the stream.
+        for (int failures = 0; failures < kMaxFailures; failures++) {
+            if (cap.read(frame) && !frame.empty()) {
+                stamp.grabbed = stamp.captured = std::chrono::steady_clock::now();
+                return true;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        return false;
+    }
+
+    bool live() const override { return true; }
+    std::string describe() const override { return "camera " + name; }
+
+private:
+    static constexpr int kMaxFailures = 200;
+    cv::VideoCapture cap;
+    std::string name;
+};
+
+/**
+ * @brief Recorded video file, decoded as fast as it is read.
+ *
+ * Frames are stamped with their media position (CAP_PROP_POS_MSEC) after
+ * the time the file was opened. Backends that do not report a position
+ * fall back to frame index / frame rate.
+ */
+class VideoFileSource : public FrameSource {
+public:
+    explicit VideoFileSource(const std::string& path)
+        : name(path), opened_at(std::chrono::steady_clock::now()) {
+        cap.open(path);
+        double rate = cap.isOpened() ? cap.get(cv::CAP_PROP_FPS) : 0.0;
+        fps = rate > 0 ? rate : 30.0;
+    }
+
+    bool isOpened() const { return cap.isOpened(); }
+
+    bool read(cv::Mat& frame, FrameStamp& stamp) override {
+        if (!cap.read(frame) || frame.empty()) return false;
+        stamp.grabbed = std::chrono::steady_clock::now();
+        double ms = cap.get(cv::CAP_PROP_POS_MSEC);
+        if (!(ms > last_ms) && frames > 0) ms = frames * 1000.0 / fps;
+        last_ms = ms;
+        frames++;
+        stamp.captured = opened_at + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                         std::chrono::duration<double, std::milli>(ms));
+        return true;
+    }
+
+    std::string describe() const override { return "video " + name; }
+
+private:
+    cv::VideoCapture cap;
+    std::string name;
+    std::chrono::steady_clock::time_point opened_at;   ///< Origin of the media timeline
+    double fps;                                        ///< Used when the backend reports no position
+    double last_ms = -1;
+    uint64_t frames = 0;
+};
+
+/**
+ * @brief Directory of still images replayed in file-name order at a fixed or maximum rate.
+ *
+ * Frame i is stamped i / fps after the directory was opened (30 fps when
+ * replayed at maximum rate), however fast it is actually read.
+ */
+class ImageDirSource : public FrameSource {
+public:
+    ImageDirSource(const std::string& dir, double fps)
+        : name(dir), rate(fps), start(std::chrono::steady_clock::now()) {
+        namespace fs = std::filesystem;
+        for (auto& entry : fs::directory_iterator(dir)) {
+            if (!entry.is_regular_file()) continue;
+            std::string ext = entry.path().extension().string();
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            if (ext == ".jpg" || ext == ".jpeg" || ext == ".png" || ext == ".bmp" || ext == ".tiff")
+                images.push_back(entry.path().string());
+        }
+        std::sort(images.begin(), images.end());
+    }
+
+    bool isOpened() const { return !images.empty(); }
+
+    bool read(cv::Mat& frame, FrameStamp& stamp) override {
+        while (next < images.size()) {
+            if (next == 0) start = std::chrono::steady_clock::now();
+            auto due = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                   std::chrono::duration<double>(next / (rate > 0 ? rate : kNominalFps)));
+            if (rate > 0) std::this_thread::sleep_until(due);
+            frame = cv::imread(images[next++]);
+            if (frame.empty()) continue;   // unreadable file: skip it
+            stamp.grabbed = std::chrono::steady_clock::now();
+            stamp.captured = due;
+            return true;
+        }
+        return false;
+    }
+
+    std::string describe() const override { return "image directory " + name; }
+
+private:
+    static constexpr double kNominalFps = 30.0;   ///< Frame spacing when replayed at maximum rate
+    std::string name;
+    double rate;
+    std::vector<std::string> images;
+    size_t next = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+/**
+ * @brief Packed BGR24 frames of a fixed size from stdin or a named pipe.
+ *
+ * A producer may stall for any length of time, so on POSIX systems the
+ * pipe is polled every kPollMs and read() gives up once the stop flag is
+ * raised or cancel() is called.
+ */
+class RawPipeSource : public FrameSource {
+public:
+    static constexpr int kPollMs = 100;
+
+    RawPipeSource(const std::string& path, int w, int h, const std::atomic<bool>* stop = nullptr)
+        : name(path), width(w), height(h), stop(stop) {
+        if (w <= 0 || h <= 0) return;
+#ifndef _WIN32
+        fd = path == "-" ? STDIN_FILENO : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        owned = fd >= 0 && path != "-";
+#else
+        file = path == "-" ? stdin : std::fopen(path.c_str(), "rb");
+        owned = file != nullptr && path != "-";
+#endif
+    }
+
+    ~RawPipeSource() override {
+#ifndef _WIN32
+        if (owned) ::close(fd);
+#else
+        if (owned) std::fclose(file);
+#endif
+    }
+
+    bool isOpened() const {
+#ifndef _WIN32
+        return fd >= 0;
+#else
+        return file != nullptr;
+#endif
+    }
+
+    bool read(cv::Mat& frame, FrameStamp& stamp) override {
+        frame = cv::Mat(height, width, CV_8UC3);   // always a fresh buffer
+        size_t bytes = frame.total() * frame.elemSize();
+#ifndef _WIN32
+        for (size_t got = 0; got < bytes;) {
+            if (stopped()) return false;
+            pollfd p{fd, POLLIN, 0};
+            int ready = poll(&p, 1, kPollMs);
+            if (ready < 0 && errno != EINTR) return false;
+            if (ready <= 0) continue;
+            ssize_t n = ::read(fd, frame.data + got, bytes - got);
+            if (n == 0) return false;   // producer closed the pipe
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                return false;
+            }
+            got += (size_t)n;
+        }
+#else
+        if (stopped() || std::fread(frame.data, 1, bytes, file) != bytes) return false;
+#endif
+        stamp.grabbed = stamp.captured = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    void cancel() override { cancelled.store(true, std::memory_order_release); }
+
+    std::string describe() const override { return "raw pipe " + name; }
+
+private:
+    std::string name;
+    int width, height;
+    const std::atomic<bool>* stop;
+    std::atomic<bool> cancelled{false};
+#ifndef _WIN32
+    int fd = -1;
+#else
+    FILE* file = nullptr;
+#endif
+    bool owned = false;
+
+    bool stopped() const {
+        return cancelled.load(std::memory_order_acquire) || (stop && stop->load(std::memory_order_acquire));
+    }
+};
+
+inline std::unique_ptr<FrameSource> FrameSource::open(const std::string& spec, const SourceOptions& opts) {
+    std::string kind, target = spec;
+    size_t colon = spec.find(':');
+    if (colon != std::string::npos) {
+        std::string prefix = spec.substr(0, colon);
+        // Anything else (a URL, "C:\...") is taken as a whole.
+        if (prefix == "camera" || prefix == "file" || prefix == "dir" || prefix == "raw") {
+            kind = prefix;
+            target = spec.substr(colon + 1);
+        }
+    }
+    if (kind.empty()) {
+        if (isAllDigits(target)) kind = "camera";
+        else if (target == "-") kind = "raw";
+        else if (std::filesystem::is_directory(target)) kind = "dir";
+        else kind = "file";
+    }
+
+    if (kind == "camera") {
+        auto src = std::make_unique<CameraSource>(target, opts);
+        if (src->isOpened()) return src;
+        std::cerr << "Cannot open camera: " << target << std::endl;
+    } else if (kind == "file") {
+        auto src = std::make_unique<VideoFileSource>(target);
+        if (src->isOpened()) return src;
+        std::cerr << "Cannot open video: " << target << std::endl;
+    } else if (kind == "dir") {
+        if (std::filesystem::is_directory(target)) {
+            auto src = std::make_unique<ImageDirSource>(target, opts.fps);
+            if (src->isOpened()) return src;
+        }
+        std::cerr << "No frames found in " << target << std::endl;
+    } else {
+        auto src = std::make_unique<RawPipeSource>(target, opts.width, opts.height, opts.stop);
+        if (src->isOpened()) return src;
+        std::cerr << "Cannot open raw pipe " << target
+                  << " (source-width and source-height are required)" << std::endl;
+    }
+    return nullptr;
+}
@@ -0,0 +1,443 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <process.h>
+#endif
+
+#include "face_gallery.hpp"
+
+/**
+ * @struct PhotoFingerprint
+ * @brief Identifies the content of an enrollment photo.
+ *
+ * size and mtime are checked first (a stat call). The content hash is
+ * computed only when they differ, so a touched but unchanged photo is not
+ * re-extracted.
+ */
+struct PhotoFingerprint {
+    uint64_t size = 0;
+    int64_t mtime = 0;       ///< Last write time, file clock ticks
+    uint64_t hash = 0;       ///< FNV-1a 64 of the file content
+
+    /**
+     * @brief size and mtime of a file, without reading it.
+     */
+    static bool stat(const std::filesystem::path& p, PhotoFingerprint& out) {
+        std::error_code ec;
+        out.size = std::filesystem::file_size(p, ec);
+        if (ec) return false;
+        auto t = std::filesystem::last_write_time(p, ec);
+        if (ec) return false;
+        out.mtime = (int64_t)t.time_since_epoch().count();
+        return true;
+    }
+
+    /**
+     * @brief size, mtime and content hash of a file (reads all of it).
+     */
+    static bool ofFile(const std::filesystem::path& p, PhotoFingerprint& out) {
+        if (!stat(p, out)) return false;
+        std::ifstream in(p, std::ios::binary);
+        std::vector<char> bytes((size_t)out.size);
+        if (!in.read(bytes.data(), (std::streamsize)bytes.size())) return false;
+        out.hash = hashBytes(bytes.data(), bytes.size());
+        return true;
+    }
+
+    static uint64_t hashBytes(const void* data, size_t n) {
+        const unsigned char* p = static_cast<const unsigned char*>(data);
+        uint64_t h = 14695981039346656037ull;
+        for (size_t i = 0; i < n; i++) {
+            h ^= p[i];
+            h *= 1099511628211ull;
+        }
+        return h;
+    }
+};
+
+/**
+ * @struct PhotoRecord
+ * @brief One enrollment photo and where its template is.
+ */
+struct PhotoRecord {
+    std::string path;            ///< Photo path as listed from the photos directory
+    PhotoFingerprint fp;
+    std::string name;            ///< Identity, from the subdirectory or the file name
+    int row = -1;                ///< Template row in the cache, -1 if no face was found
+};
+
+/**
+ * @struct EnrolledPhotos
+ * @brief The photo records of a gallery built in this process, with the
+ *        same find()/face() lookup as GalleryCache.
+ *
+ * Lets a reload reuse the templates of unchanged photos when there is no
+ * gallery cache file to take them from.
+ */
+struct EnrolledPhotos {
+    std::vector<PhotoRecord> records;                    ///< row = template row in gallery
+    std::unordered_map<std::string, size_t> by_path;
+    std::shared_ptr<const FaceGallery> gallery;
+
+    void assign(std::vector<PhotoRecord> recs, std::shared_ptr<const FaceGallery> g) {
+        records = std::move(recs);
+        gallery = std::move(g);
+        by_path.clear();
+        for (size_t i = 0; i < records.size(); i++) by_path.emplace(records[i].path, i);
+    }
+
+    const PhotoRecord* find(const std::string& path) const {
+        auto it = by_path.find(path);
+        return it == by_path.end() ? nullptr : &records[it->second];
+    }
+
+    /**
+     * @brief A template of gallery as a kFaceSize x kFaceSize image (no copy).
+     */
+    cv::Mat face(int row) const {
+        return cv::Mat(FaceGallery::kFaceSize, FaceGallery::kFaceSize, CV_8UC1,
+                       const_cast<unsigned char*>(gallery->data((size_t)row)));
+    }
+};
+
+/**
+ * @class GalleryCache
+ * @brief Versioned binary file with the extracted templates of every enrollment photo.
+ *
+ * Layout (native byte order, all blocks 64-byte aligned):
+ * header | photo records | templates (rows x kTemplateBytes) | 25x25 rows |
+ * 50x50 rows | identities (centroid row, radius) | centroids.
+ * The file is memory-mapped, so opening it costs the same for any gallery
+ * size; the template and centroid blocks are used in place (see
+ * FaceGallery::adopt).
+ * A file with another version, template geometry, cascade or a truncated
+ * body is ignored and rebuilt.
+ */
+class GalleryCache {
+public:
+    /// Bumped whenever the layout or the template extraction changes, so old templates are not mixed in.
+    static constexpr uint32_t kVersion = 4;
+
+    /**
+     * @brief Map a cache file.
+     * @param cascade Fingerprint of the cascade file the templates must have been extracted with.
+     * @return false if it is missing or not usable (nothing is kept then).
+     */
+    bool open(const std::string& path, const PhotoFingerprint& cascade) {
+        close();
+        if (!mapFile(path)) return false;
+        if (!parse(cascade)) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close() {
+        records.clear();
+        by_path.clear();
+        mapping.reset();
+        base = nullptr;
+        length = 0;
+        header = Header();
+    }
+
+    const std::vector<PhotoRecord>& photos() const { return records; }
+
+    /**
+     * @brief Record of a photo path, or nullptr.
+     */
+    const PhotoRecord* find(const std::string& path) const {
+        auto it = by_path.find(path);
+        return it == by_path.end() ? nullptr : &records[it->second];
+    }
+
+    /**
+     * @brief A cached template as a kFaceSize x kFaceSize image (no copy).
+     */
+    cv::Mat face(int row) const {
+        return cv::Mat(FaceGallery::kFaceSize, FaceGallery::kFaceSize, CV_8UC1,
+                       const_cast<unsigned char*>(base + header.templates_offset + (size_t)row * FaceGallery::kTemplateBytes));
+    }
+
+    /**
+     * @brief Load the gallery straight from the mapped rows and centroids
+     *        (rows with the same name become templates of one identity).
+     * @return false if the identity block does not match the rows.
+     */
+    bool adoptInto(FaceGallery& gallery) const {
+        std::vector<std::string> names(header.rows);
+        for (const PhotoRecord& r : records)
+            if (r.row >= 0) names[r.row] = r.name;
+        auto rows = [&](uint32_t n, uint64_t offset, int cols) {
+            return cv::Mat((int)n, cols, CV_8UC1, const_cast<unsigned char*>(base + offset));
+        };
+        std::vector<int> centroid_of(header.identity_count);
+        std::vector<double> radii(header.identity_count);
+        for (uint32_t i = 0; i < header.identity_count; i++) {
+            IdentityEntry e;
+            std::memcpy(&e, base + header.identities_offset + (size_t)i * sizeof(IdentityEntry), sizeof(e));
+            centroid_of[i] = e.centroid_row;
+            radii[i] = e.radius;
+        }
+        return gallery.adopt(rows(header.rows, header.templates_offset, FaceGallery::kTemplateBytes),
+                             rows(header.rows, header.coarse_offset, FaceGallery::kCoarseBytes),
+                             rows(header.rows, header.mid_offset, FaceGallery::kMidBytes), names,
+                             rows(header.centroid_count, header.centroids_offset, FaceGallery::kTemplateBytes),
+                             std::move(centroid_of), std::move(radii), mapping);
+    }
+
+    /**
+     * @brief Write a cache file for records, in order; faces[i] is the template of
+     *        records[i] (empty if no face). Row numbers are assigned here.
+     *        gallery must have been built by adding the non-empty faces in
+     *        order; its centroids and radii are stored with the rows, and
+     *        cascade is the fingerprint of the cascade file used to extract them.
+     *        The file is replaced atomically (written to a temporary file named
+     *        after the process, then renamed), so processes sharing a cache
+     *        never write the same temporary file.
+     */
+    static bool write(const std::string& path, const PhotoFingerprint& cascade, std::vector<PhotoRecord> recs,
+                      const std::vector<cv::Mat>& faces, const FaceGallery& gallery) {
+        Header h;
+        h.cascade_size = cascade.size;
+        h.cascade_mtime = cascade.mtime;
+        h.cascade_hash = cascade.hash;
+        std::string body;
+        for (size_t i = 0; i < recs.size(); i++) {
+            PhotoRecord& r = recs[i];
+            r.row = faces[i].empty() ? -1 : (int)h.rows++;
+            appendPod(body, r.fp.size);
+            appendPod(body, r.fp.mtime);
+            appendPod(body, r.fp.hash);
+            appendPod(body, (int32_t)r.row);
+            appendPod(body, (uint32_t)r.path.size());
+            appendPod(body, (uint32_t)r.name.size());
+            body += r.path;
+            body += r.name;
+        }
+        h.record_count = (uint32_t)recs.size();
+        h.records_offset = sizeof(Header);
+        h.templates_offset = align(h.records_offset + body.size());
+        h.coarse_offset = align(h.templates_offset + (uint64_t)h.rows * FaceGallery::kTemplateBytes);
+        h.mid_offset = align(h.coarse_offset + (uint64_t)h.rows * FaceGallery::kCoarseBytes);
+        h.identity_count = (uint32_t)gallery.size();
+        h.identities_offset = align(h.mid_offset + (uint64_t)h.rows * FaceGallery::kMidBytes);
+        std::string identities;
+        for (size_t i = 0; i < gallery.size(); i++) {
+            IdentityEntry e;
+            e.centroid_row = gallery.centroid(i) ? (int32_t)h.centroid_count++ : -1;
+            e.radius = gallery.radiusOf(i);
+            appendPod(identities, e);
+        }
+        h.centroids_offset = align(h.identities_offset + identities.size());
+        h.file_size = h.centroids_offset + (uint64_t)h.centroid_count * FaceGallery::kTemplateBytes;
+
+        const std::string tmp = path + "." + std::to_string(processId()) + ".tmp";
+        {
+            std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+            if (!out.is_open()) return false;
+            out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+            out.write(body.data(), (std::streamsize)body.size());
+            pad(out, h.templates_offset);
+            for (const cv::Mat& f : faces)
+                if (!f.empty()) writeRow(out, f);
+            // Pyramid levels are cheap to recompute: one pass per block keeps the writes sequential.
+            std::vector<unsigned char> coarse(FaceGallery::kCoarseBytes), mid(FaceGallery::kMidBytes);
+            for (int level = 0; level < 2; level++) {
+                pad(out, level == 0 ? h.coarse_offset : h.mid_offset);
+                for (const cv::Mat& f : faces) {
+                    if (f.empty()) continue;
+                    cv::Mat c = f.isContinuous() ? f : f.clone();
+                    FaceGallery::pyramid(c.ptr<unsigned char>(), coarse.data(), mid.data());
+                    const std::vector<unsigned char>& v = level == 0 ? coarse : mid;
+                    out.write(reinterpret_cast<const char*>(v.data()), (std::streamsize)v.size());
+                }
+            }
+            pad(out, h.identities_offset);
+            out.write(identities.data(), (std::streamsize)identities.size());
+            pad(out, h.centroids_offset);
+            for (size_t i = 0; i < gallery.size(); i++)
+                if (const unsigned char* c = gallery.centroid(i))
+                    out.write(reinterpret_cast<const char*>(c), FaceGallery::kTemplateBytes);
+            if (!out.good()) {
+                out.close();
+                std::error_code ignored;
+                std::filesystem::remove(tmp, ignored);
+                return false;
+            }
+        }
+        std::error_code ec;
+        std::filesystem::rename(tmp, path, ec);
+        if (ec) std::filesystem::remove(tmp, ec);
+        return !ec;
+    }
+
+private:
+    struct Header {
+        char magic[8] = {'F', 'A', 'C', 'E', 'G', 'A', 'L', '\0'};
+        uint32_t version = kVersion;
+        uint32_t face_size = FaceGallery::kFaceSize;
+        uint32_t coarse_size = FaceGallery::kCoarseSize;
+        uint32_t mid_size = FaceGallery::kMidSize;
+        uint32_t record_count = 0;
+        uint32_t rows = 0;                 ///< Template rows (photos with a face)
+        uint32_t identity_count = 0;       ///< Distinct names among the rows
+        uint32_t centroid_count = 0;       ///< Identities with more than one row
+        uint64_t cascade_size = 0;         ///< Cascade file the templates were extracted with
+        int64_t cascade_mtime = 0;
+        uint64_t cascade_hash = 0;
+        uint64_t records_offset = 0;
+        uint64_t templates_offset = 0;
+        uint64_t coarse_offset = 0;
+        uint64_t mid_offset = 0;
+        uint64_t identities_offset = 0;
+        uint64_t centroids_offset = 0;
+        uint64_t file_size = 0;
+    };
+
+    /**
+     * @brief Per identity, in order of its first row.
+     */
+    struct IdentityEntry {
+        int32_t centroid_row = -1;         ///< Row in the centroid block, -1 for a single template
+        uint32_t reserved = 0;
+        double radius = 0;
+    };
+
+    Header header;
+    std::shared_ptr<const void> mapping;   ///< Unmaps the file when the last user is gone
+    const unsigned char* base = nullptr;
+    size_t length = 0;
+    std::vector<PhotoRecord> records;
+    std::unordered_map<std::string, size_t> by_path;
+
+    static long processId() {
+#ifndef _WIN32
+        return (long)getpid();
+#else
+        return (long)_getpid();
+#endif
+    }
+
+    static uint64_t align(uint64_t off) { return (off + 63) & ~(uint64_t)63; }
+
+    template <class T>
+    static void appendPod(std::string& out, const T& v) {
+        out.append(reinterpret_cast<const char*>(&v), sizeof(T));
+    }
+
+    template <class T>
+    bool readPod(size_t& off, T& v) const {
+        if (off + sizeof(T) > length) return false;
+        std::memcpy(&v, base + off, sizeof(T));
+        off += sizeof(T);
+        return true;
+    }
+
+    static void pad(std::ofstream& out, uint64_t offset) {
+        static const char zeros[64] = {};
+        uint64_t at = (uint64_t)out.tellp();
+        if (at < offset) out.write(zeros, (std::streamsize)(offset - at));
+    }
+
+    static void writeRow(std::ofstream& out, const cv::Mat& f) {
+        CV_Assert(f.type() == CV_8UC1 && f.rows == FaceGallery::kFaceSize && f.cols == FaceGallery::kFaceSize);
+        for (int y = 0; y < f.rows; y++)
+            out.write(reinterpret_cast<const char*>(f.ptr<unsigned char>(y)), f.cols);
+    }
+
+    bool mapFile(const std::string& path) {
+#ifndef _WIN32
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(Header)) {
+            ::close(fd);
+            return false;
+        }
+        size_t n = (size_t)st.st_size;
+        // Private writable mapping: rows adopted by a FaceGallery may later be
+        // overwritten in place (copy-on-write, the file is never modified).
+        void* p = mmap(nullptr, n, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) return false;
+        mapping = std::shared_ptr<const void>(p, [n](const void* q) { munmap(const_cast<void*>(q), n); });
+        base = static_cast<const unsigned char*>(p);
+        length = n;
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in.is_open()) return false;
+        size_t n = (size_t)in.tellg();
+        if (n < sizeof(Header)) return false;
+        auto buf = std::make_shared<std::vector<unsigned char>>(n + 64);
+        unsigned char* p = buf->data() + (64 - (uintptr_t)buf->data() % 64) % 64;
+        in.seekg(0);
+        if (!in.read(reinterpret_cast<char*>(p), (std::streamsize)n)) return false;
+        mapping = std::shared_ptr<const void>(buf, p);
+        base = p;
+        length = n;
+#endif
+        return true;
+    }
+
+    bool parse(const PhotoFingerprint& cascade) {
+        std::memcpy(&header, base, sizeof(Header));
+        const Header expected;
+        if (std::memcmp(header.magic, expected.magic, sizeof(header.magic)) != 0 ||
+            header.version != kVersion || header.face_size != expected.face_size ||
+            header.coarse_size != expected.coarse_size || header.mid_size != expected.mid_size ||
+            header.file_size != length)
+            return false;
+        // Another cascade finds other crops; a touched but identical file is fine.
+        if (header.cascade_size != cascade.size || header.cascade_hash != cascade.hash) return false;
+        // Blocks must follow each other in order, each large enough for its rows.
+        if (header.records_offset < sizeof(Header) || header.templates_offset < header.records_offset ||
+            header.coarse_offset < header.templates_offset + (uint64_t)header.rows * FaceGallery::kTemplateBytes ||
+            header.mid_offset < header.coarse_offset + (uint64_t)header.rows * FaceGallery::kCoarseBytes ||
+            header.identities_offset < header.mid_offset + (uint64_t)header.rows * FaceGallery::kMidBytes ||
+            header.centroids_offset < header.identities_offset + (uint64_t)header.identity_count * sizeof(IdentityEntry) ||
+            header.centroids_offset + (uint64_t)header.centroid_count * FaceGallery::kTemplateBytes > length)
+            return false;
+        // Fixed part of a record: size, mtime, hash, row, path and name lengths.
+        const uint64_t min_record = 3 * sizeof(uint64_t) + 3 * sizeof(uint32_t);
+        if (header.record_count > (header.templates_offset - header.records_offset) / min_record) return false;
+
+        size_t off = header.records_offset;
+        records.resize(header.record_count);
+        by_path.reserve(header.record_count);
+        for (size_t i = 0; i < records.size(); i++) {
+            PhotoRecord& r = records[i];
+            int32_t row;
+            uint32_t path_len, name_len;
+            if (!readPod(off, r.fp.size) || !readPod(off, r.fp.mtime) || !readPod(off, r.fp.hash) ||
+                !readPod(off, row) || !readPod(off, path_len) || !readPod(off, name_len) ||
+                off + path_len + name_len > header.templates_offset)
+                return false;
+            if (row >= (int32_t)header.rows) return false;
+            r.row = row;
+            r.path.assign(reinterpret_cast<const char*>(base + off), path_len);
+            off += path_len;
+            r.name.assign(reinterpret_cast<const char*>(base + off), name_len);
+            off += name_len;
+            by_path[r.path] = i;
+        }
+        return true;
+    }
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+/**
+ * @struct ImageHeader
+ * @brief Pixel dimensions of an encoded image, read from its header
+ *        without decoding it (JPEG, PNG and BMP).
+ */
+struct ImageHeader {
+    int width = 0;
+    int height = 0;
+
+    /**
+     * @return false if the format is not recognized or the header is truncated.
+     */
+    static bool parse(const unsigned char* p, size_t n, ImageHeader& out) {
+        if (n >= 24 && p[0] == 0x89 && p[1] == 'P' && p[2] == 'N' && p[3] == 'G') {
+            out.width = (int)be32(p + 16);
+            out.height = (int)be32(p + 20);
+            return out.width > 0 && out.height > 0;
+        }
+        if (n >= 26 && p[0] == 'B' && p[1] == 'M') {
+            out.width = (int)le32(p + 18);
+            out.height = std::abs((int)le32(p + 22));   // negative: stored top-down
+            return out.width > 0 && out.height > 0;
+        }
+        if (n >= 4 && p[0] == 0xFF && p[1] == 0xD8) return parseJpeg(p, n, out);
+        return false;
+    }
+
+    /**
+     * @brief Largest decode reduction (1, 2, 4 or 8) that keeps the long
+     *        side at least min_long_side pixels.
+     */
+    int reduction(int min_long_side) const {
+        int f = 8;
+        while (f > 1 && std::max(width, height) / f < min_long_side) f /= 2;
+        return f;
+    }
+
+    /**
+     * @brief cv::imdecode flag for a grayscale decode at 1/factor scale.
+     */
+    static int grayFlag(int factor) {
+        switch (factor) {
+        case 8: return cv::IMREAD_REDUCED_GRAYSCALE_8;
+        case 4: return cv::IMREAD_REDUCED_GRAYSCALE_4;
+        case 2: return cv::IMREAD_REDUCED_GRAYSCALE_2;
+        default: return cv::IMREAD_GRAYSCALE;
+        }
+    }
+
+private:
+    static uint32_t be32(const unsigned char* p) { return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+    static uint32_t le32(const unsigned char* p) { return (uint32_t)p[3] << 24 | p[2] << 16 | p[1] << 8 | p[0]; }
+
+    /**
+     * @brief Walk the marker segments up to the first start-of-frame.
+     */
+    static bool parseJpeg(const unsigned char* p, size_t n, ImageHeader& out) {
+        size_t i = 2;
+        while (i + 4 <= n) {
+            if (p[i] != 0xFF) return false;
+            unsigned char m = p[i + 1];
+            if (m == 0xFF) {               // fill byte
+                i++;
+                continue;
+            }
+            if (m == 0x01 || (m >= 0xD0 && m <= 0xD7)) {   // no length field
+                i += 2;
+                continue;
+            }
+            size_t len = (size_t)p[i + 2] << 8 | p[i + 3];
+            bool sof = m >= 0xC0 && m <= 0xCF && m != 0xC4 && m != 0xC8 && m != 0xCC;
+            if (sof) {
+                if (i + 9 > n) return false;
+                out.height = p[i + 5] << 8 | p[i + 6];
+                out.width = p[i + 7] << 8 | p[i + 8];
+                return out.width > 0 && out.height > 0;
+            }
+            if (m == 0xD9 || m == 0xDA || len < 2) return false;   // image data before any frame header
+            i += 2 + len;
+        }
+        return false;
+    }
+};
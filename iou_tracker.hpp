@@ -0,0 +1,131 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+/**
+ * @class IouTracker
+ * @brief Gives the face boxes of consecutive frames stable track IDs.
+ *
+ * Boxes are associated with live tracks greedily, best pair first. Pairs
+ * overlapping by at least kMinIoU score by IoU. Below that, pairs whose
+ * centres are within kMaxCenterShift box sizes score by centre distance, so
+ * a fast-moving face still matches. A new track is confirmed only after
+ * kBirthHits matched frames, which hides single-frame false detections. A
+ * confirmed track survives up to kMaxMisses frames without a box, so one
+ * missed detection does not change the ID. Only box geometry is used, and
+ * the buffers are reused: association costs microseconds even with dozens
+ * of faces.
+ */
+class IouTracker {
+public:
+    static constexpr double kMinIoU = 0.3;          ///< Overlap that always counts as the same face
+    static constexpr double kMaxCenterShift = 0.5;  ///< Else: max centre shift, in track box sizes
+    static constexpr int kBirthHits = 2;            ///< Matched frames before a track gets confirmed
+    static constexpr int kMaxMisses = 5;            ///< Frames a confirmed track coasts without a box
+
+    /**
+     * @brief Associate this frame's boxes with the tracks.
+     * @param ids Out: track ID per box, or -1 while its track is not confirmed yet.
+     */
+    void update(const std::vector<cv::Rect>& boxes, std::vector<int>& ids) {
+        pairs.clear();
+        for (size_t t = 0; t < tracks.size(); t++)
+            for (size_t b = 0; b < boxes.size(); b++) {
+                double s = score(tracks[t].box, boxes[b]);
+                if (s > 0) pairs.push_back({s, (int)t, (int)b});
+            }
+        std::sort(pairs.begin(), pairs.end(), [](const Pair& a, const Pair& b) { return a.score > b.score; });
+
+        track_of_box.assign(boxes.size(), -1);
+        track_matched.assign(tracks.size(), false);
+        for (const Pair& p : pairs) {
+            if (track_matched[p.track] || track_of_box[p.box] >= 0) continue;
+            track_matched[p.track] = true;
+            track_of_box[p.box] = p.track;
+        }
+
+        for (size_t t = 0; t < tracks.size(); t++) {
+            Track& tr = tracks[t];
+            if (track_matched[t]) {
+                tr.hits++;
+                tr.misses = 0;
+            } else {
+                tr.misses++;
+            }
+        }
+        for (size_t b = 0; b < boxes.size(); b++) {
+            if (track_of_box[b] >= 0) {
+                tracks[track_of_box[b]].box = boxes[b];
+            } else {
+                track_of_box[b] = (int)tracks.size();
+                tracks.push_back({next_id++, boxes[b], 1, 0});
+            }
+        }
+
+        ids.resize(boxes.size());
+        for (size_t b = 0; b < boxes.size(); b++) {
+            const Track& tr = tracks[track_of_box[b]];
+            ids[b] = confirmed(tr) ? tr.id : -1;
+        }
+
+        // Deaths: unconfirmed tracks on their first miss, confirmed ones after kMaxMisses.
+        tracks.erase(std::remove_if(tracks.begin(), tracks.end(), [](const Track& tr) {
+                         return tr.misses > (confirmed(tr) ? kMaxMisses : 0);
+                     }),
+                     tracks.end());
+    }
+
+    /**
+     * @brief IDs of all confirmed tracks, including those coasting without a box this frame.
+     */
+    void liveIds(std::vector<int>& out) const {
+        out.clear();
+        for (const Track& tr : tracks)
+            if (confirmed(tr)) out.push_back(tr.id);
+    }
+
+    bool empty() const { return tracks.empty(); }
+    void clear() { tracks.clear(); }
+
+private:
+    struct Track {
+        int id;
+        cv::Rect box;        ///< Last associated box
+        int hits;            ///< Frames with an associated box
+        int misses;          ///< Consecutive frames without one
+    };
+
+    struct Pair {
+        double score;
+        int track;
+        int box;
+    };
+
+    std::vector<Track> tracks;
+    int next_id = 0;
+    std::vector<Pair> pairs;                ///< Reused candidate list
+    std::vector<int> track_of_box;          ///< Reused: track index per box
+    std::vector<bool> track_matched;        ///< Reused: track got a box this frame
+
+    static bool confirmed(const Track& tr) { return tr.hits >= kBirthHits; }
+
+    /**
+     * @brief Association score: IoU when >= kMinIoU, else a centre-distance
+     *        score below kMinIoU, 0 if the boxes are unrelated.
+     */
+    static double score(const cv::Rect& track, const cv::Rect& box) {
+        double inter = (track & box).area();
+        double uni = (double)track.area() + box.area() - inter;
+        double iou = uni > 0 ? inter / uni : 0.0;
+        if (iou >= kMinIoU) return iou;
+
+        double dx = (track.x + track.width * 0.5) - (box.x + box.width * 0.5);
+        double dy = (track.y + track.height * 0.5) - (box.y + box.height * 0.5);
+        double reach = kMaxCenterShift * std::max(track.width, track.height);
+        double d = std::sqrt(dx * dx + dy * dy);
+        return d < reach ? kMinIoU * (1.0 - d / reach) : 0.0;
+    }
+};
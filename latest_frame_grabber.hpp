@@ -0,0 +1,120 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <thread>
+
+#include "frame_source.hpp"
+
+/**
+ * @class LatestFrameGrabber
+ * @brief Drains a FrameSource on its own thread and keeps only the newest frame.
+ *
+ * A slow consumer never reads stale frames out of the driver buffer: frames
+ * it did not pick up in time are overwritten and counted as dropped. Every
+ * frame keeps the capture time reported by its source.
+ */
+class LatestFrameGrabber {
+public:
+    explicit LatestFrameGrabber(FrameSource& source) : src(source) {
+        worker = std::thread([this] { run(); });
+    }
+
+    ~LatestFrameGrabber() {
+        running.store(false, std::memory_order_release);
+        src.cancel();            // a source blocked in read() would keep join() waiting
+        ready.notify_all();
+        worker.join();
+    }
+
+    LatestFrameGrabber(const LatestFrameGrabber&) = delete;
+    LatestFrameGrabber& operator=(const LatestFrameGrabber&) = delete;
+
+    /**
+     * @brief Wait for a frame newer than the last one returned.
+     * @return false if cancel was raised or the source ended.
+     */
+    bool next(cv::Mat& frame, FrameStamp& stamp,
+              const std::atomic<bool>& cancel) {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!has_new) {
+            if (cancel.load(std::memory_order_acquire) || !running.load(std::memory_order_acquire))
+                return false;
+            ready.wait_for(lock, std::chrono::milliseconds(10));
+        }
+        take(frame, stamp);
+        return true;
+    }
+
+    /**
+     * @brief Take a frame newer than the last one returned, if there is one, without waiting.
+     */
+    bool tryNext(cv::Mat& frame, FrameStamp& stamp) {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!has_new) return false;
+        take(frame, stamp);
+        return true;
+    }
+
+    /**
+     * @brief The source ended and its last frame has been handed out.
+     */
+    bool finished() {
+        std::lock_guard<std::mutex> lock(mtx);
+        return !has_new && !running.load(std::memory_order_acquire);
+    }
+
+    uint64_t grabbedCount() const { return grabbed.load(std::memory_order_relaxed); }
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    void dump(std::ostream& os) const {
+        os << "[Stats] Latest-frame capture: grabbed " << grabbedCount()
+           << ", dropped " << droppedCount() << " stale frames\n";
+    }
+
+private:
+    FrameSource& src;
+    std::thread worker;
+    std::atomic<bool> running{true};
+
+    std::mutex mtx;
+    std::condition_variable ready;
+    cv::Mat latest;                                       ///< Newest frame, guarded by mtx
+    FrameStamp latest_stamp;                              ///< Its capture time, guarded by mtx
+    bool has_new = false;                                 ///< latest not yet handed out, guarded by mtx
+
+    std::atomic<uint64_t> grabbed{0};
+    std::atomic<uint64_t> dropped{0};
+
+    /// Hand out latest; the caller holds mtx.
+    void take(cv::Mat& frame, FrameStamp& stamp) {
+        frame = latest;          // hand over the handle; the grabber reads into a fresh Mat next time
+        latest.release();
+        stamp = latest_stamp;
+        has_new = false;
+    }
+
+    void run() {
+        while (running.load(std::memory_order_acquire)) {
+            cv::Mat frame;   // fresh buffer: the previous one may still be in use downstream
+            FrameStamp stamp;
+            if (!src.read(frame, stamp)) break;
+            grabbed.fetch_add(1, std::memory_order_relaxed);
+            {
+                std::lock_guard<std::mutex> lock(mtx);
+                if (has_new) dropped.fetch_add(1, std::memory_order_relaxed);
+                latest = frame;
+                latest_stamp = stamp;
+                has_new = true;
+            }
+            ready.notify_one();
+        }
+        running.store(false, std::memory_order_release);
+        ready.notify_all();
+    }
+};
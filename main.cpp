@@ -8,11 +8,38 @@
 #include <ctime>
 #include <sstream>
 #include <iomanip>
+#include <algorithm>
+#include <cmath>
+#include <atomic>
+#include <thread>
+#include <memory>
+#include <csignal>
+#include <mutex>
+
+#include "engine_config.hpp"
+#include "face_gallery.hpp"
+#include "face_tracker.hpp"
+#include "frame_source.hpp"
+#include "gallery_cache.hpp"
+#include "image_header.hpp"
+#include "iou_tracker.hpp"
+#include "latest_frame_grabber.hpp"
+#include "motion_gate.hpp"
+#include "photo_watcher.hpp"
+#include "recognition_cache.hpp"
+#include "spsc_ring.hpp"
+#include "stage_stats.hpp"
+#include "vote_window.hpp"
 
 using namespace cv;
 using namespace std;
 namespace fs = std::filesystem;
 
+/// Raised by SIGINT/SIGTERM in headless mode.
+static atomic<bool> g_stop_requested{false};
+/// Raised by SIGUSR1 in headless mode to print the stage timings.
+static atomic<bool> g_dump_requested{false};
+
 /**
  * @class AttendanceSystem
  * @brief Implements a face recognition-based attendance system using OpenCV.
@@ -23,28 +50,29 @@ namespace fs = std::filesystem;
  * - Verify faces for 3 seconds before marking attendance.
  * - Prevent duplicate attendance marking for the same person per day.
  * - Display real-time status on the webcam interface.
+ * - Serve several cameras from one process with a shared gallery and worker pool.
  */
 class AttendanceSystem {
 private:
+    EngineConfig config;                                  ///< Run-time settings
     CascadeClassifier face_cascade;                       ///< Haar cascade classifier for face detection
     string photos_path;                                   ///< Path to stored known face images
     string cascade_path;                                  ///< Path to Haar cascade XML file
-    string attendance_file;                               ///< CSV file to store attendance
-    unordered_set<string> attendance_set;                ///< Names already marked today
-    unordered_map<string, Mat> known_faces;              ///< Map: name -> processed face image
-    unordered_map<string, chrono::steady_clock::time_point> last_mark_time; ///< Cooldown tracker
+    string attendance_file;                               ///< CSV file to store attendance; empty keeps marks in memory only
+    unordered_set<string> attendance_set;                ///< Names already marked today, guarded by attendance_mutex
+    shared_ptr<const FaceGallery> known_faces;            ///< Enrolled face templates; replaced whole, read with atomic_load
+    mutable mutex attendance_mutex;                       ///< Serializes marking across cameras
     chrono::seconds mark_cooldown = chrono::seconds(10); ///< Minimum time between consecutive marks
     string current_date;                                  ///< Today's date
+    EnrolledPhotos enrolled;                              ///< Records of the published gallery; only the enrolling thread touches it
+    unique_ptr<PhotoWatcher> photo_watcher;               ///< Reloads the gallery on photo changes (declared last: stops first)
 
 public:
     /**
      * @brief Constructor: Loads cascade, known faces, and today's attendance.
      */
-    AttendanceSystem(
-        const string& photos = "photos",
-        const string& cascade = "haarcascade_frontalface_default.xml",
-        const string& file = "attendance.csv")
-        : photos_path(photos), cascade_path(cascade), attendance_file(file)
+    explicit AttendanceSystem(const EngineConfig& cfg = EngineConfig())
+        : config(cfg), photos_path(cfg.photos), cascade_path(cfg.cascade), attendance_file(cfg.attendance)
     {
         current_date = getCurrentDate();
 
@@ -53,8 +81,14 @@ public:
             exit(EXIT_FAILURE);
         }
 
+        // A replay is a benchmark: its marks must neither be suppressed by
+        // today's real rows nor land in the live CSV.
+        if (!config.replay.empty()) attendance_file.clear();
+
         loadAttendance();
         loadKnownFaces();
+        if (config.watch_photos)
+            photo_watcher = make_unique<PhotoWatcher>(photos_path, [this](const atomic<bool>& running) { reloadKnownFaces(running); });
     }
 
     /**
@@ -96,6 +130,7 @@ public:
      * @brief Load already marked attendance for today from CSV.
      */
     void loadAttendance() {
+        if (attendance_file.empty()) return;
         ifstream file(attendance_file);
         if (!file.is_open()) return;
 
@@ -114,21 +149,30 @@ public:
     /**
      * @brief Mark attendance for a given name (if not already marked).
      * @param name Name of the person.
+     * @param now Capture time of the frame that verified the person; the cooldown runs on it.
+     * @param last_mark_time Cooldown tracker of the stream now comes from.
+     *        Capture times of different sources are on different timelines
+     *        (media position vs. grab time), so each stream keeps its own.
+     * @return true if a new attendance row was written (or, with no
+     *         attendance file, recorded in memory).
      */
-    void markAttendance(const string& name) {
-        auto now = chrono::steady_clock::now();
-        if (last_mark_time.count(name) && (now - last_mark_time[name]) < mark_cooldown)
-            return;
+    bool markAttendance(const string& name, chrono::steady_clock::time_point now,
+                        unordered_map<string, chrono::steady_clock::time_point>& last_mark_time) {
+        lock_guard<mutex> lock(attendance_mutex);
+        auto last = last_mark_time.find(name);
+        if (last != last_mark_time.end() && (now - last->second) < mark_cooldown)
+            return false;
 
         last_mark_time[name] = now;
 
         if (attendance_set.count(name)) {
             cout << "[Attendance] Already marked today: " << name
                  << " (" << current_date << ", " << getCurrentDay() << ")" << endl;
-            return;
+            return false;
         }
 
         attendance_set.insert(name);
+        if (attendance_file.empty()) return true;
 
         ofstream file(attendance_file, ios::app);
         if (file.is_open()) {
@@ -138,38 +182,271 @@ public:
             cout << "[Attendance] Successfully marked: " << name
                  << " | " << current_date << " (" << day << ")" << endl;
             file.close();
+            return true;
         }
+        return false;
+    }
+
+    /**
+     * @brief Whether name already has a row for today.
+     */
+    bool isMarkedToday(const string& name) const {
+        lock_guard<mutex> lock(attendance_mutex);
+        return attendance_set.count(name) != 0;
+    }
+
+    /**
+     * @brief Number of people marked today.
+     */
+    size_t markedCount() const {
+        lock_guard<mutex> lock(attendance_mutex);
+        return attendance_set.size();
     }
 
     /**
      * @brief Load known faces from the photos directory into memory.
      */
     void loadKnownFaces() {
-        if (!fs::exists(photos_path) || !fs::is_directory(photos_path)) {
+        shared_ptr<const FaceGallery> gallery = enrollPhotos();
+        if (!gallery) exit(EXIT_FAILURE);
+        atomic_store(&known_faces, gallery);
+    }
+
+    /**
+     * @brief Re-enroll the photos directory and publish the new gallery.
+     *
+     * Runs on the photo watcher thread. The new gallery is built aside and
+     * swapped in with one atomic pointer store (RCU style): recognition keeps
+     * using the gallery it loaded for the current frame, the old one is freed
+     * when its last reader is done. Attendance state is not touched. Any
+     * failure, including an exception, keeps the current gallery.
+     * @param running Cleared when the watcher shuts down; enrollment stops early then.
+     */
+    void reloadKnownFaces(const atomic<bool>& running) {
+        shared_ptr<const FaceGallery> gallery;
+        try {
+            gallery = enrollPhotos(&running);
+        } catch (const exception& e) {
+            cerr << "[Warn] " << e.what() << endl;
+        }
+        if (!running.load(memory_order_acquire)) return;
+        if (!gallery) {
+            cerr << "[Warn] Gallery reload failed; keeping the current gallery" << endl;
+            return;
+        }
+        atomic_store(&known_faces, gallery);
+        cout << "[Info] Gallery reloaded: " << gallery->size() << " identities" << endl;
+    }
+
+    /**
+     * @brief Enroll every photo of the photos directory into a new gallery.
+     *
+     * A photo directly in the photos directory belongs to the name at the start
+     * of its file name (Bob_1.jpg -> Bob); a photo in a subdirectory belongs
+     * to the subdirectory's name (Bob/front.jpg -> Bob). Every photo with a
+     * face becomes one template of its identity.
+     *
+     * Photos are enrolled in path order. Templates come from the gallery
+     * cache when a photo's size and mtime (or, failing that, its content hash)
+     * are unchanged; only new or changed photos are decoded and run through
+     * the cascade, and deleted photos drop out. When nothing changed the
+     * cached rows are used in place. Without a usable cache file the rows of
+     * the previously enrolled gallery are reused the same way.
+     *
+     * Runs in the constructor and then only on the watcher thread, never
+     * concurrently, which is what keeps enrolled unsynchronized.
+     * @param keep_going Optional: enrollment gives up when it is cleared.
+     * @return nullptr (after printing why) if there is no usable face, or
+     *         nullptr if keep_going was cleared.
+     */
+    shared_ptr<const FaceGallery> enrollPhotos(const atomic<bool>* keep_going = nullptr) {
+        error_code ec;
+        if (!fs::is_directory(photos_path, ec)) {
             cerr << "Photos path not found: " << photos_path << endl;
-            exit(EXIT_FAILURE);
+            return nullptr;
+        }
+        auto gallery = make_shared<FaceGallery>();
+        gallery->setCoarseToFine((size_t)config.coarse_keep, (size_t)config.mid_keep);
+        gallery->setScoring((size_t)config.match_topk);
+        auto start = chrono::steady_clock::now();
+
+        vector<PhotoRecord> records;
+        // Non-throwing overloads: files may come and go while the watcher reloads.
+        auto addPhoto = [&](const fs::directory_entry& entry, const string& name) {
+            error_code file_ec;
+            if (!entry.is_regular_file(file_ec) || !isImage(entry.path().extension().string())) return;
+            PhotoRecord r;
+            r.path = entry.path().string();
+            r.name = name;
+            if (PhotoFingerprint::stat(entry.path(), r.fp)) records.push_back(move(r));
+        };
+        const fs::directory_iterator end;
+        for (fs::directory_iterator it(photos_path, ec); !ec && it != end; it.increment(ec)) {
+            error_code sub_ec;
+            if (it->is_directory(sub_ec)) {
+                // A person's directory that vanished or cannot be read just contributes no photos.
+                for (fs::directory_iterator photo(it->path(), sub_ec); !sub_ec && photo != end; photo.increment(sub_ec))
+                    addPhoto(*photo, it->path().filename().string());
+            } else {
+                addPhoto(*it, inferName(it->path().stem().string()));
+            }
+        }
+        if (ec) {
+            cerr << "Cannot list " << photos_path << ": " << ec.message() << endl;
+            return nullptr;
+        }
+        sort(records.begin(), records.end(),
+             [](const PhotoRecord& a, const PhotoRecord& b) { return a.path < b.path; });
+
+        // The cache is only valid for templates cut by the same cascade.
+        PhotoFingerprint cascade_fp;
+        bool use_cache = !config.gallery_cache.empty() && PhotoFingerprint::ofFile(cascade_path, cascade_fp);
+        GalleryCache cache;
+        bool cached = use_cache && cache.open(config.gallery_cache, cascade_fp);
+        const EnrolledPhotos* previous = !cached && enrolled.gallery ? &enrolled : nullptr;
+        vector<const PhotoRecord*> hits(records.size(), nullptr);
+        size_t stat_hits = 0;
+        for (size_t i = 0; i < records.size() && (cached || previous); i++) {
+            const PhotoRecord* c = cached ? cache.find(records[i].path) : previous->find(records[i].path);
+            if (c && c->fp.size == records[i].fp.size && c->fp.mtime == records[i].fp.mtime) {
+                hits[i] = c;
+                stat_hits++;
+            }
         }
 
+        // Warm start: the directory is exactly what the cache was built from.
         size_t loaded = 0;
-        for (auto& entry : fs::directory_iterator(photos_path)) {
-            if (!entry.is_regular_file()) continue;
-            string ext = entry.path().extension().string();
-            if (!isImage(ext)) continue;
-
-            string name = inferName(entry.path().stem().string());
-            Mat img = imread(entry.path().string());
-            Mat face = extractFace(img);
-            if (!face.empty()) {
-                known_faces[name] = face;
-                loaded++;
+        bool warm = cached && stat_hits == records.size() && cache.photos().size() == records.size() &&
+                    cache.adoptInto(*gallery);
+        size_t extracted = 0;
+        if (warm) {
+            loaded = gallery->templateCount();
+            for (size_t i = 0; i < records.size(); i++) records[i] = *hits[i];
+        } else {
+            vector<Mat> faces(records.size());
+            bool prepared = cached ? preparePhotos(records, hits, &cache, faces, extracted, keep_going)
+                                   : preparePhotos(records, hits, previous, faces, extracted, keep_going);
+            if (!prepared) return nullptr;
+            gallery->reserve(records.size());
+            // Merge in file-name order, whatever order the threads finished in.
+            for (size_t i = 0; i < records.size(); i++) {
+                records[i].row = -1;
+                if (!faces[i].empty()) {
+                    gallery->add(records[i].name, faces[i]);
+                    records[i].row = (int)loaded++;
+                }
             }
+            if (use_cache && !GalleryCache::write(config.gallery_cache, cascade_fp, records, faces, *gallery))
+                cerr << "[Warn] Could not write gallery cache " << config.gallery_cache << endl;
         }
 
         if (loaded == 0) {
             cerr << "No usable faces found in " << photos_path << endl;
-            exit(EXIT_FAILURE);
+            return nullptr;
+        }
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        cout << "[Info] Loaded " << loaded << " face templates of " << gallery->size() << " identities (" << extracted << " of " << records.size()
+             << " photos extracted" << (warm ? ", cache mapped" : "") << ") in "
+             << fixed << setprecision(1) << ms << " ms.\n";
+        cout.unsetf(ios::floatfield);
+        enrolled.assign(move(records), gallery);
+        return gallery;
+    }
+
+    /**
+     * @brief Get the template of every photo, from the cache where possible.
+     *
+     * Photos that need reading are spread over config.enroll_threads threads,
+     * each with its own cascade (CascadeClassifier is not safe to share).
+     * Photo i only ever writes records[i] and faces[i], so the result is the
+     * same for any scheduling. Progress is printed every second.
+     * @param cache Mapped gallery cache or previously enrolled photos (find()
+     *              and face()), or nullptr.
+     * @param extracted_out Set to the number of photos decoded and run through the cascade.
+     * @param keep_going Optional: workers stop taking photos when it is cleared.
+     * @return false (after printing why) if the cascade cannot be loaded, or
+     *         false if keep_going was cleared. This may run on the watcher
+     *         thread, so it must not exit the process.
+     */
+    template <class Cache>
+    bool preparePhotos(vector<PhotoRecord>& records, const vector<const PhotoRecord*>& hits,
+                       const Cache* cache, vector<Mat>& faces, size_t& extracted_out,
+                       const atomic<bool>* keep_going) {
+        auto cancelled = [&] { return keep_going && !keep_going->load(memory_order_acquire); };
+        extracted_out = 0;
+        vector<size_t> todo;
+        for (size_t i = 0; i < records.size(); i++) {
+            if (!hits[i]) {
+                todo.push_back(i);
+            } else {
+                records[i].fp.hash = hits[i]->fp.hash;
+                if (hits[i]->row >= 0) faces[i] = cache->face(hits[i]->row);
+            }
+        }
+        if (todo.empty()) return true;
+
+        size_t n_threads = config.enroll_threads > 0
+            ? (size_t)config.enroll_threads
+            : (size_t)max(1u, thread::hardware_concurrency());
+        n_threads = min(n_threads, todo.size());
+        vector<CascadeClassifier> cascades(n_threads);
+        for (auto& c : cascades) {
+            if (!c.load(cascade_path)) {
+                cerr << "Error: Could not load face cascade from " << cascade_path << endl;
+                return false;
+            }
+        }
+
+        atomic<size_t> next{0}, done{0}, extracted{0};
+        auto work = [&](CascadeClassifier& cascade) {
+            for (size_t k; !cancelled() && (k = next.fetch_add(1, memory_order_relaxed)) < todo.size();
+                 done.fetch_add(1, memory_order_release)) {
+                PhotoRecord& r = records[todo[k]];
+                vector<uchar> bytes;
+                if (!readFile(r.path, bytes)) {
+                    r.fp.mtime = -1;   // never matches, so it is retried on the next start
+                    continue;
+                }
+                r.fp.hash = PhotoFingerprint::hashBytes(bytes.data(), bytes.size());
+                const PhotoRecord* c = cache ? cache->find(r.path) : nullptr;
+                if (c && c->fp.size == r.fp.size && c->fp.hash == r.fp.hash) {
+                    // Touched but unchanged.
+                    if (c->row >= 0) faces[todo[k]] = cache->face(c->row);
+                    continue;
+                }
+                try {
+                    faces[todo[k]] = extractFace(bytes, cascade);
+                } catch (const exception& e) {
+                    // An exception escaping a worker thread would terminate the process.
+                    cerr << "[Warn] " << r.path << ": " << e.what() << endl;
+                }
+                extracted.fetch_add(1, memory_order_relaxed);
+            }
+        };
+
+        auto start = chrono::steady_clock::now();
+        vector<thread> workers;
+        for (size_t t = 0; t < n_threads; t++) workers.emplace_back(work, ref(cascades[t]));
+        auto next_report = start + chrono::seconds(1);
+        while (done.load(memory_order_acquire) < todo.size() && !cancelled()) {
+            this_thread::sleep_for(chrono::milliseconds(50));
+            auto now = chrono::steady_clock::now();
+            if (now < next_report) continue;
+            next_report = now + chrono::seconds(1);
+            size_t d = done.load(memory_order_acquire);
+            cout << "[Enroll] " << d << "/" << todo.size() << " photos, "
+                 << (size_t)(d / chrono::duration<double>(now - start).count()) << " photos/s" << endl;
         }
-        cout << "[Info] Loaded " << loaded << " known faces.\n";
+        for (auto& t : workers) t.join();
+        if (cancelled()) return false;
+
+        double s = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        cout << "[Enroll] Read " << todo.size() << " photos on " << n_threads << " threads in "
+             << fixed << setprecision(2) << s << " s (" << setprecision(0)
+             << (s > 0 ? todo.size() / s : 0.0) << " photos/s)" << endl;
+        cout.unsetf(ios::floatfield);
+        extracted_out = extracted.load();
+        return true;
     }
 
     /**
@@ -177,93 +454,736 @@ public:
      *        Displays verification messages and prevents duplicate attendance marking.
      */
     void runAttendance() {
-        VideoCapture cap(0);
-        if (!cap.isOpened()) {
-            cerr << "Cannot open webcam!" << endl;
-            return;
-        }
-        cout << "Press 'q' to quit.\n";
+        unique_ptr<FrameSource> source = FrameSource::open(config.source, sourceOptions());
+        if (!source) return;
+        cout << "Press 'q' to quit, 's' to print stage timings.\n";
 
-        string candidate_name = "Unknown";
-        chrono::steady_clock::time_point candidate_start;
-        bool verified_today = false;
+        atomic<bool> stop{false};
+        runCamera(*source, true, stop);
+    }
 
-        while (true) {
-            Mat frame;
-            cap >> frame;
-            if (frame.empty()) continue;
+    /**
+     * @brief Run attendance without any window, drawing or key polling,
+     *        until SIGINT/SIGTERM. SIGUSR1 prints the stage timings.
+     * @return false if the frame source could not be opened, or if a live
+     *         camera stopped delivering frames before a stop was requested.
+     */
+    bool runHeadless() {
+        installSignalHandlers();
+        unique_ptr<FrameSource> source = FrameSource::open(config.source, sourceOptions());
+        if (!source) return false;
+        cout << "[Info] Headless attendance running on " << source->describe()
+             << "; send SIGINT or SIGTERM to stop." << endl;
 
-            Mat gray;
-            cvtColor(frame, gray, COLOR_BGR2GRAY);
-            equalizeHist(gray, gray);
+        runCamera(*source, false, g_stop_requested);
 
-            vector<Rect> faces;
-            face_cascade.detectMultiScale(gray, faces, 1.1, 5, 0, Size(80,80));
+        cout << "[Info] Stopped. Attendance for " << current_date << ": "
+             << markedCount() << " marked." << endl;
+        return !cameraLost(*source);
+    }
 
-            string detected_name = "Unknown";
-            for (auto& r : faces) {
-                Mat roi = gray(r);
-                resize(roi, roi, Size(200,200));
-                detected_name = recognizeFace(roi);
+    /**
+     * @brief Whether source is a live camera that ended on its own, i.e.
+     *        without SIGINT/SIGTERM (prints an error if so).
+     */
+    static bool cameraLost(const FrameSource& source) {
+        if (!source.live() || g_stop_requested.load(memory_order_acquire)) return false;
+        cerr << "Error: " << source.describe() << " stopped delivering frames" << endl;
+        return true;
+    }
+
+    /**
+     * @brief Serve every camera in config.cameras from this process until
+     *        SIGINT/SIGTERM or until all sources end. No GUI, like headless mode.
+     *
+     * The gallery and the attendance store are shared. Each camera keeps its
+     * own verification state and stage stats and a latest-frame grabber, so
+     * a busy pool drops stale frames instead of queueing them. A fixed pool
+     * of workers, each with its own cascade (CascadeClassifier is not safe to
+     * share between threads), takes whichever camera has a new frame; a
+     * camera is processed by one worker at a time, so its frames stay in
+     * order. SIGUSR1 prints the per-camera stats.
+     * @return false if a camera could not be opened, or if a live camera
+     *         stopped delivering frames before a stop was requested.
+     */
+    bool runMultiCamera() {
+        installSignalHandlers();
+        vector<unique_ptr<CameraSession>> cams;
+        for (const string& spec : config.cameraList()) {
+            unique_ptr<FrameSource> source = FrameSource::open(spec, sourceOptions());
+            if (!source) return false;
+            cams.push_back(make_unique<CameraSession>(move(source), config));
+        }
+        if (cams.empty()) {
+            cerr << "No cameras given" << endl;
+            return false;
+        }
+        for (auto& cam : cams) cam->state.grabber = make_unique<LatestFrameGrabber>(*cam->source);
 
-                rectangle(frame, r, Scalar(255,0,0), 2);
-                putText(frame, detected_name, Point(r.x, max(0, r.y-10)),
-                        FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0,255,0),2);
+        size_t n_workers = config.workers > 0
+            ? (size_t)config.workers
+            : min(cams.size(), (size_t)max(1u, thread::hardware_concurrency()));
+        vector<CascadeClassifier> detectors(n_workers);
+        for (auto& d : detectors) {
+            if (!d.load(cascade_path)) {
+                cerr << "Error: Could not load face cascade from " << cascade_path << endl;
+                exit(EXIT_FAILURE);
             }
+        }
+        cout << "[Info] Serving " << cams.size() << " cameras with " << n_workers
+             << " workers; send SIGINT or SIGTERM to stop." << endl;
 
-            // Verification logic
-            auto now = chrono::steady_clock::now();
-            if (detected_name != "Unknown") {
-                if (candidate_name != detected_name) {
-                    candidate_name = detected_name;
-                    candidate_start = now;
-                    verified_today = false;
-                } else {
-                    auto duration = chrono::duration_cast<chrono::seconds>(now - candidate_start).count();
-                    if (duration >= 3) {
-                        if (attendance_set.count(candidate_name)) {
-                            // Already marked → show red continuously
-                            putText(frame, "Attendance Marked For Today: " + candidate_name, Point(10,30),
-                                    FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0,165,255),2);
-                            verified_today = true;
-                        } else if (!verified_today) {
-                            markAttendance(candidate_name);
-                            verified_today = true;
-                            putText(frame, "Attendance Successful: " + candidate_name, Point(10,30),
-                                    FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0,255,0),2);
-                        } else {
-                            putText(frame, "Attendance Successful: " + candidate_name, Point(10,30),
-                                    FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0,255,0),2);
+        atomic<size_t> cursor{0};
+        atomic<size_t> running{n_workers};
+        vector<thread> workers;
+        for (size_t w = 0; w < n_workers; w++) {
+            workers.emplace_back([&, w] {
+                while (!g_stop_requested.load(memory_order_acquire)) {
+                    bool worked = false, live = false;
+                    for (size_t k = 0; k < cams.size() && !worked; k++) {
+                        CameraSession& cam = *cams[cursor.fetch_add(1, memory_order_relaxed) % cams.size()];
+                        if (cam.busy.exchange(true, memory_order_acquire)) {
+                            live = true;
+                            continue;
                         }
-                    } else {
-                        putText(frame, "Verifying " + candidate_name + "...", Point(10,30),
-                                FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0,255,255),2);
+                        Mat frame;
+                        FrameStamp stamp;
+                        if (cam.state.grabber->tryNext(frame, stamp)) {
+                            cam.state.detector = &detectors[w];
+                            FrameResult result = processFrame(frame, stamp.captured, cam.state);
+                            noteDecision(result, stamp.grabbed, cam.state);
+                            worked = true;
+                        }
+                        if (!cam.state.grabber->finished()) live = true;
+                        cam.busy.store(false, memory_order_release);
                     }
+                    if (!live && !worked) break;   // every source has ended
+                    if (!worked) this_thread::sleep_for(chrono::milliseconds(1));
                 }
-            } else {
-                candidate_name.clear();
-                verified_today = false;
+                running.fetch_sub(1, memory_order_release);
+            });
+        }
+
+        auto dumpAll = [&] {
+            for (size_t i = 0; i < cams.size(); i++) {
+                CameraSession& cam = *cams[i];
+                while (cam.busy.exchange(true, memory_order_acquire)) this_thread::yield();
+                cout << "\n[Camera " << i << "] " << cam.source->describe();
+                dumpStats(cam.state);
+                cam.busy.store(false, memory_order_release);
             }
+        };
+        while (running.load(memory_order_acquire) > 0) {
+            if (g_dump_requested.exchange(false)) dumpAll();
+            this_thread::sleep_for(chrono::milliseconds(50));
+        }
+        for (auto& t : workers) t.join();
 
-            imshow("Attendance", frame);
-            char c = (char)waitKey(10);
-            if(c == 'q' || c=='Q') break;
+        dumpAll();
+        for (auto& cam : cams) cam->state.grabber.reset();   // stop reading before the sources go away
+        cout << "[Info] Stopped. Attendance for " << current_date << ": "
+             << markedCount() << " marked." << endl;
+        bool lost = false;
+        for (auto& cam : cams) lost |= cameraLost(*cam->source);
+        return !lost;
+    }
+
+    /**
+     * @brief Drive the attendance loop on an opened source until it ends or
+     *        stop is raised (or 'q' is pressed when there is a GUI).
+     * @param gui Draw the overlay and show it; false skips all drawing and HighGUI calls.
+     */
+    void runCamera(FrameSource& source, bool gui, atomic<bool>& stop) {
+        SessionState state(config);
+        if (config.latest_frame) state.grabber = make_unique<LatestFrameGrabber>(source);
+
+        if (config.pipeline) {
+            runPipelined(source, state, gui, stop);
+        } else {
+            while (!stop.load(memory_order_acquire)) {
+                Mat frame;
+                FrameStamp stamp;
+                if (!grabFrame(source, state, frame, stamp, stop)) break;
+
+                FrameResult result = processFrame(frame, stamp.captured, state);
+                noteDecision(result, stamp.grabbed, state);
+                if (gui) {
+                    if (!showFrame(frame, result, state, 10)) break;
+                } else if (g_dump_requested.exchange(false)) {
+                    dumpStats(state);
+                }
+            }
+        }
+
+        if (gui) destroyAllWindows();
+        dumpStats(state);
+        state.grabber.reset();   // stop reading before the source goes away
+    }
+
+    /**
+     * @brief Replay a video file or an image-sequence directory through the
+     *        attendance pipeline without any GUI, then print throughput stats.
+     * @param spec Frame source spec (see FrameSource::open), usually a video
+     *             file or a directory of frames (sorted by name).
+     * Marks go to an in-memory store that starts empty; the attendance CSV
+     * is neither read nor written.
+     * @return false if the source could not be opened.
+     */
+    bool runReplay(const string& spec) {
+        unique_ptr<FrameSource> source = FrameSource::open(spec, sourceOptions());
+        if (!source) return false;
+
+        SessionState state(config);
+        vector<double> latencies_ms;
+        latencies_ms.reserve(4096);
+        size_t marks = 0;
+
+        auto run_start = chrono::steady_clock::now();
+        while (true) {
+            Mat frame;
+            FrameStamp stamp;
+            {
+                StageStats::Scope t(state.stats, Stage::Capture);
+                if (!source->read(frame, stamp)) break;
+            }
+
+            auto t0 = chrono::steady_clock::now();
+            FrameResult result = processFrame(frame, stamp.captured, state);
+            auto t1 = chrono::steady_clock::now();
+            noteDecision(result, t0, state);
+
+            latencies_ms.push_back(chrono::duration<double, milli>(t1 - t0).count());
+            if (result.marked) marks++;
         }
+        double elapsed_s = chrono::duration<double>(chrono::steady_clock::now() - run_start).count();
 
-        cap.release();
-        destroyAllWindows();
+        cout << "\n[Replay] " << source->describe() << "\n";
+        cout << "  Frames      : " << latencies_ms.size() << "\n";
+        cout << "  Throughput  : " << fixed << setprecision(2)
+             << (elapsed_s > 0 ? latencies_ms.size() / elapsed_s : 0.0) << " fps\n";
+        sort(latencies_ms.begin(), latencies_ms.end());
+        cout << "  Latency p50 : " << percentile(latencies_ms, 0.50) << " ms\n";
+        cout << "  Latency p95 : " << percentile(latencies_ms, 0.95) << " ms\n";
+        cout << "  Latency p99 : " << percentile(latencies_ms, 0.99) << " ms\n";
+        cout << "  Marks       : " << marks << "\n";
+        cout.unsetf(ios::floatfield);
+        dumpStats(state);
+        return true;
     }
 
     /**
      * @brief Display today's attendance in console.
      */
     void viewAttendanceToday() {
+        lock_guard<mutex> lock(attendance_mutex);
         cout << "\nAttendance for " << current_date << ":\n";
         if(attendance_set.empty()) cout << "No attendance yet.\n";
         for(auto &name : attendance_set) cout << "- " << name << "\n";
     }
 
 private:
+    /**
+     * @brief Verification progress of one face in view.
+     */
+    struct FaceVerification {
+        string name;                                  ///< Name recognized in consecutive frames (leading name when voting)
+        chrono::steady_clock::time_point start;       ///< First frame of the current run of name
+        bool verified_today = false;                  ///< The check already passed for name
+        VoteWindow votes;                             ///< Recent per-frame results, with verify_votes > 0
+    };
+
+    /**
+     * @brief Per-stream state carried between consecutive frames.
+     */
+    struct SessionState {
+        unordered_map<int, FaceVerification> verifying;  ///< Per face in view, keyed by track ID
+        FaceTracker tracker;                  ///< Follows faces between detections
+        IouTracker associator;                ///< Gives the boxes of consecutive frames stable track IDs
+        int frames_since_detect = 0;          ///< Frames tracked since the last full detection
+        MotionGate motion;                    ///< Skips static frames
+        bool had_faces = false;               ///< Previous processed frame contained faces
+        unique_ptr<LatestFrameGrabber> grabber; ///< Set when capture runs in latest-frame mode
+        int last_match = -1;                  ///< Gallery identity of the last recognized face
+        unordered_map<string, chrono::steady_clock::time_point> last_mark_time; ///< Marking cooldown per name, on this stream's timeline
+        StageStats stats;                     ///< Per-stage frame loop latency of this stream
+        CascadeClassifier* detector = nullptr; ///< Cascade for full detections; nullptr = face_cascade
+
+        RecognitionCache recognitions;        ///< Per-track recognition results
+        shared_ptr<const FaceGallery> gallery_seen; ///< Gallery version last_match and recognitions refer to
+
+        explicit SessionState(const EngineConfig& cfg)
+            : motion(cfg.motion_threshold), recognitions(cfg.recognize_every, cfg.recognize_change) {}
+    };
+
+    /**
+     * @brief One camera served by runMultiCamera().
+     */
+    struct CameraSession {
+        unique_ptr<FrameSource> source;
+        SessionState state;                   ///< Touched only by the worker holding busy
+        atomic<bool> busy{false};             ///< A worker is processing this camera
+
+        CameraSession(unique_ptr<FrameSource> src, const EngineConfig& cfg)
+            : source(move(src)), state(cfg) {}
+    };
+
+    /**
+     * @brief Everything a frame produced that is needed to draw its overlay.
+     */
+    struct FrameResult {
+        vector<Rect> faces;               ///< Detected face rectangles
+        vector<int> ids;                  ///< Track ID per face (-1 until the track is confirmed)
+        vector<int> live_ids;             ///< Every confirmed track, also those missed in this frame
+        vector<string> names;             ///< Recognized name per face
+        vector<string> statuses;          ///< Verification banners, one per face being verified
+        vector<Scalar> status_colors;     ///< Banner colors
+        bool marked = false;              ///< A new attendance row was written
+        double latency_ms = -1;           ///< Capture-to-decision latency, shown in latest-frame mode
+    };
+
+    /**
+     * @brief Run detection, recognition and verification on one BGR frame.
+     *        Does not touch the frame, so it is usable with or without a GUI.
+     */
+    FrameResult processFrame(const Mat& frame, chrono::steady_clock::time_point captured_at, SessionState& vs) {
+        FrameResult result;
+        Mat gray;
+        if (detectStage(frame, vs, gray, result))
+            recognizeStage(gray, captured_at, vs, result);
+        return result;
+    }
+
+    /**
+     * @brief First half of processFrame: motion gate, gray conversion,
+     *        equalization and face localization.
+     *        Touches only the detection fields of SessionState.
+     * @return false if the motion gate skipped the frame.
+     */
+    bool detectStage(const Mat& frame, SessionState& vs, Mat& gray, FrameResult& result) {
+        // Nothing moved and nobody was in view: skip detection and recognition.
+        // A live ID track counts as in view: it coasts through IouTracker::kMaxMisses
+        // missed detections, so one miss on a person standing still does not close the gate.
+        if (config.motion_threshold > 0) {
+            bool moved;
+            {
+                StageStats::Scope t(vs.stats, Stage::Motion);
+                moved = vs.motion.update(frame);
+            }
+            bool skip = !moved && !vs.had_faces && vs.tracker.empty() && vs.associator.empty();
+            vs.motion.count(skip);
+            if (skip) return false;
+        }
+
+        {
+            StageStats::Scope t(vs.stats, Stage::Convert);
+            cvtColor(frame, gray, COLOR_BGR2GRAY);
+        }
+        {
+            StageStats::Scope t(vs.stats, Stage::Equalize);
+            equalizeHist(gray, gray);
+        }
+        locateFaces(gray, vs, result.faces);
+        vs.had_faces = !result.faces.empty();
+        {
+            StageStats::Scope t(vs.stats, Stage::Associate);
+            vs.associator.update(result.faces, result.ids);
+            vs.associator.liveIds(result.live_ids);
+        }
+        return true;
+    }
+
+    /**
+     * @brief Second half of processFrame: recognition of result.faces,
+     *        verification and attendance marking.
+     *        Touches only the verification fields of SessionState.
+     *
+     * Every face in view is verified on its own, keyed by its track ID, so a
+     * group is verified in parallel within the same 3-second window.
+     */
+    void recognizeStage(const Mat& gray, chrono::steady_clock::time_point captured_at,
+                        SessionState& vs, FrameResult& result) {
+        // One gallery version for the whole frame, even if a reload publishes a new one meanwhile.
+        shared_ptr<const FaceGallery> gallery = atomic_load(&known_faces);
+        if (gallery != vs.gallery_seen) {
+            // Cached names and the match hint refer to the previous version.
+            vs.gallery_seen = gallery;
+            vs.recognitions.clear();
+            vs.last_match = -1;
+        }
+        if (vs.recognitions.enabled()) vs.recognitions.prune(result.live_ids);
+        for (size_t i = 0; i < result.faces.size(); i++) {
+            Mat roi = gray(result.faces[i]);
+            string name;
+            if (vs.recognitions.enabled()) {
+                StageStats::Scope t(vs.stats, Stage::Recognize);
+                if (vs.recognitions.lookup(result.ids[i], roi, name)) {
+                    result.names.push_back(name);
+                    continue;
+                }
+            }
+            {
+                StageStats::Scope t(vs.stats, Stage::Resize);
+                resize(roi, roi, Size(200,200));
+            }
+            {
+                StageStats::Scope t(vs.stats, Stage::Recognize);
+                name = recognizeFace(roi, *gallery, vs);
+            }
+            if (vs.recognitions.enabled()) vs.recognitions.store(result.ids[i], name);
+            result.names.push_back(name);
+        }
+
+        // Faces whose track died start over.
+        for (auto it = vs.verifying.begin(); it != vs.verifying.end();) {
+            if (find(result.live_ids.begin(), result.live_ids.end(), it->first) == result.live_ids.end())
+                it = vs.verifying.erase(it);
+            else
+                ++it;
+        }
+
+        // Verification logic, timed by capture time so that processing jitter
+        // and replay speed do not change the window.
+        const auto now = captured_at;
+        for (size_t i = 0; i < result.faces.size(); i++) {
+            const string& detected_name = result.names[i];
+            if (result.ids[i] < 0) continue;   // not confirmed yet
+            if (config.verify_votes > 0) {
+                voteFace(vs.verifying[result.ids[i]], detected_name, now, vs, result);
+                continue;
+            }
+            if (detected_name == "Unknown") {
+                vs.verifying.erase(result.ids[i]);
+                continue;
+            }
+            FaceVerification& v = vs.verifying[result.ids[i]];
+            if (v.name != detected_name) {
+                v.name = detected_name;
+                v.start = now;
+                v.verified_today = false;
+                continue;
+            }
+            auto duration = chrono::duration_cast<chrono::seconds>(now - v.start).count();
+            if (duration >= 3) {
+                reportVerified(v, now, vs, result);
+            } else {
+                result.statuses.push_back("Verifying " + v.name + "...");
+                result.status_colors.push_back(Scalar(0,255,255));
+            }
+        }
+    }
+
+    /**
+     * @brief k-of-n verification: add this frame's vote and accept the
+     *        leading name once it has verify_votes votes within the last
+     *        verify_window seconds. Stray "Unknown" or wrong frames only cost
+     *        one vote instead of restarting the check.
+     */
+    void voteFace(FaceVerification& v, const string& detected_name,
+                  chrono::steady_clock::time_point now, SessionState& vs, FrameResult& result) {
+        v.votes.add(now, detected_name);
+        auto window = chrono::duration_cast<chrono::steady_clock::duration>(
+            chrono::duration<double>(config.verify_window));
+        size_t votes = 0;
+        string leader = v.votes.leader(now, window, votes);
+        if (leader.empty()) return;
+        if (leader != v.name) {
+            v.name = leader;
+            v.verified_today = false;
+        }
+        if (v.verified_today || votes >= (size_t)config.verify_votes) {
+            reportVerified(v, now, vs, result);
+        } else {
+            result.statuses.push_back("Verifying " + v.name + "... (" + to_string(votes) + "/" +
+                                      to_string(config.verify_votes) + ")");
+            result.status_colors.push_back(Scalar(0,255,255));
+        }
+    }
+
+    /**
+     * @brief v.name passed verification: mark it (once) and add its banner.
+     */
+    void reportVerified(FaceVerification& v, chrono::steady_clock::time_point now, SessionState& vs,
+                        FrameResult& result) {
+        if (isMarkedToday(v.name)) {
+            // Already marked → show orange continuously
+            result.statuses.push_back("Attendance Marked For Today: " + v.name);
+            result.status_colors.push_back(Scalar(0,165,255));
+            v.verified_today = true;
+            return;
+        }
+        if (!v.verified_today) {
+            if (markAttendance(v.name, now, vs.last_mark_time)) result.marked = true;
+            v.verified_today = true;
+        }
+        result.statuses.push_back("Attendance Successful: " + v.name);
+        result.status_colors.push_back(Scalar(0,255,0));
+    }
+
+    /**
+     * @brief Find face rectangles in an equalized gray frame.
+     *
+     * With detect_interval N > 1 the Haar cascade runs every N-th frame (or
+     * when a track is lost) and the faces are followed by FaceTracker in between.
+     */
+    void locateFaces(const Mat& gray, SessionState& vs, vector<Rect>& faces) {
+        if (config.detect_interval > 1 && ++vs.frames_since_detect < config.detect_interval) {
+            bool all_found;
+            {
+                StageStats::Scope t(vs.stats, Stage::Track);
+                all_found = vs.tracker.update(gray);
+            }
+            if (all_found) {
+                faces = vs.tracker.boxes();
+                return;
+            }
+        }
+
+        {
+            StageStats::Scope t(vs.stats, Stage::Detect);
+            detectFaces(gray, vs.detector ? *vs.detector : face_cascade, faces);
+        }
+        if (config.detect_interval > 1) {
+            vs.tracker.reset(gray, faces);
+            vs.frames_since_detect = 0;
+        }
+    }
+
+    /**
+     * @brief Run the Haar cascade, optionally on a downscaled copy of the frame.
+     *
+     * With detect_scale f > 1 the cascade sees the frame shrunk by f with a
+     * minimum face size of 80/f, and the rectangles are mapped back to full
+     * resolution so the recognition crop keeps its quality.
+     */
+    void detectFaces(const Mat& gray, CascadeClassifier& cascade, vector<Rect>& faces) {
+        if (config.detect_scale <= 1.0) {
+            cascade.detectMultiScale(gray, faces, 1.1, 5, 0, Size(80,80));
+            return;
+        }
+
+        const double f = config.detect_scale;
+        Mat small;
+        resize(gray, small, Size((int)lround(gray.cols / f), (int)lround(gray.rows / f)), 0, 0, INTER_AREA);
+        int min_side = max(1, (int)lround(80 / f));
+        cascade.detectMultiScale(small, faces, 1.1, 5, 0, Size(min_side, min_side));
+
+        const Rect frame_rect(0, 0, gray.cols, gray.rows);
+        for (Rect& r : faces) {
+            r = Rect((int)lround(r.x * f), (int)lround(r.y * f),
+                     (int)lround(r.width * f), (int)lround(r.height * f)) & frame_rect;
+        }
+        faces.erase(remove_if(faces.begin(), faces.end(), [](const Rect& r) { return r.empty(); }),
+                    faces.end());
+    }
+
+    /**
+     * @brief A frame travelling through the threaded pipeline.
+     */
+    struct FramePacket {
+        Mat frame;                        ///< Captured BGR frame (shared handle, never copied)
+        Mat gray;                         ///< Equalized gray frame from the detection stage
+        bool detected = false;            ///< detectStage ran (not skipped by the motion gate)
+        FrameStamp stamp;                 ///< When the frame was captured and read
+        FrameResult result;
+    };
+
+    /**
+     * @brief Run the attendance loop as four stages on their own threads:
+     *        capture -> detection -> recognition/verification -> render.
+     *
+     * Stages are linked by bounded SPSC rings, so a slow detector applies
+     * back-pressure instead of queueing frames without bound. Verification
+     * and markAttendance run only on the recognition thread, in frame order,
+     * so results are the same as the serial loop. Rendering stays on the
+     * calling thread because HighGUI windows must be driven from one thread;
+     * without a GUI that thread only drains results. Raising stop (or 'q')
+     * winds all stages down.
+     */
+    void runPipelined(FrameSource& source, SessionState& state, bool gui, atomic<bool>& stop) {
+        SpscRing<FramePacket, 4> captured, detected, recognized;
+        atomic<bool> capture_done{false}, detect_done{false}, recognize_done{false};
+
+        // In latest-frame mode the grabber already runs its own capture thread
+        // and the detection stage takes the newest frame from it directly.
+        thread capture_thread;
+        if (!state.grabber) {
+            capture_thread = thread([&] {
+                while (!stop.load(memory_order_acquire)) {
+                    FramePacket p;
+                    if (!grabFrame(source, state, p.frame, p.stamp, stop)) break;
+                    if (!captured.push(move(p), stop)) break;
+                }
+                capture_done.store(true, memory_order_release);
+            });
+        }
+        auto nextFrame = [&](FramePacket& p) {
+            if (!state.grabber) return captured.pop(p, capture_done);
+            return grabFrame(source, state, p.frame, p.stamp, stop);
+        };
+
+        thread detect_thread([&] {
+            FramePacket p;
+            while (nextFrame(p)) {
+                p.detected = detectStage(p.frame, state, p.gray, p.result);
+                if (!detected.push(move(p), stop)) break;
+            }
+            detect_done.store(true, memory_order_release);
+        });
+
+        thread recognize_thread([&] {
+            FramePacket p;
+            while (detected.pop(p, detect_done)) {
+                if (p.detected) recognizeStage(p.gray, p.stamp.captured, state, p.result);
+                noteDecision(p.result, p.stamp.grabbed, state);
+                if (!recognized.push(move(p), stop)) break;
+            }
+            recognize_done.store(true, memory_order_release);
+        });
+
+        FramePacket p;
+        while (recognized.pop(p, recognize_done)) {
+            if (gui) {
+                if (!showFrame(p.frame, p.result, state, 1)) break;
+            } else if (g_dump_requested.exchange(false)) {
+                dumpStats(state);
+            }
+        }
+
+        stop.store(true, memory_order_release);
+        source.cancel();   // 'q' raises only the local stop; wake a capture thread blocked in read()
+        if (capture_thread.joinable()) capture_thread.join();
+        detect_thread.join();
+        recognize_thread.join();
+    }
+
+    /**
+     * @brief Draw the overlay, show the frame and handle keys.
+     * @return false if the user asked to quit.
+     */
+    bool showFrame(Mat& frame, const FrameResult& result, SessionState& vs, int wait_ms) {
+        {
+            StageStats::Scope t(vs.stats, Stage::Draw);
+            drawOverlay(frame, result);
+        }
+        char c;
+        {
+            StageStats::Scope t(vs.stats, Stage::Display);
+            imshow("Attendance", frame);
+            c = (char)waitKey(wait_ms);
+        }
+        if(c == 'q' || c=='Q') return false;
+        if(c == 's' || c=='S') dumpStats(vs);
+        return true;
+    }
+
+    /**
+     * @brief Get the next frame, either straight from the source or, in
+     *        latest-frame mode, the newest frame from the grabber thread.
+     * @return false once no more frames will come (source ended or cancel raised).
+     */
+    bool grabFrame(FrameSource& source, SessionState& vs, Mat& frame,
+                   FrameStamp& stamp, const atomic<bool>& cancel) {
+        StageStats::Scope t(vs.stats, Stage::Capture);
+        if (vs.grabber) return vs.grabber->next(frame, stamp, cancel);
+        return !cancel.load(memory_order_acquire) && source.read(frame, stamp);
+    }
+
+    /**
+     * @brief Frame source parameters from the configuration.
+     */
+    SourceOptions sourceOptions() const {
+        SourceOptions opts;
+        opts.width = config.source_width;
+        opts.height = config.source_height;
+        opts.fps = config.source_fps;
+        opts.stop = &g_stop_requested;
+        return opts;
+    }
+
+    /**
+     * @brief Record the capture-to-decision latency of a frame whose
+     *        verification outcome has just been decided.
+     */
+    void noteDecision(FrameResult& result, chrono::steady_clock::time_point grabbed_at, SessionState& vs) {
+        auto us = chrono::duration_cast<chrono::microseconds>(chrono::steady_clock::now() - grabbed_at).count();
+        vs.stats.record(Stage::Decision, (uint64_t)us);
+        if (config.latest_frame) result.latency_ms = us / 1000.0;
+    }
+
+    /**
+     * @brief Print stage timings and, if enabled, motion gate and capture counters.
+     */
+    void dumpStats(const SessionState& vs) {
+        vs.stats.dump(cout);
+        if (config.motion_threshold > 0) vs.motion.dump(cout);
+        if (vs.recognitions.enabled()) vs.recognitions.dump(cout);
+        if (vs.grabber) vs.grabber->dump(cout);
+    }
+
+    /**
+     * @brief Draw face boxes, names and the verification banner onto a frame.
+     */
+    static void drawOverlay(Mat& frame, const FrameResult& result) {
+        for (size_t i = 0; i < result.faces.size(); i++) {
+            const Rect& r = result.faces[i];
+            rectangle(frame, r, Scalar(255,0,0), 2);
+            putText(frame, result.names[i], Point(r.x, max(0, r.y-10)),
+                    FONT_HERSHEY_SIMPLEX, 0.8, Scalar(0,255,0),2);
+        }
+        for (size_t i = 0; i < result.statuses.size(); i++)
+            putText(frame, result.statuses[i], Point(10, 30 + 30 * (int)i),
+                    FONT_HERSHEY_SIMPLEX, 0.8, result.status_colors[i],2);
+        if (result.latency_ms >= 0) {
+            ostringstream ss;
+            ss << fixed << setprecision(0) << result.latency_ms << " ms";
+            putText(frame, ss.str(), Point(10, max(20, frame.rows - 10)),
+                    FONT_HERSHEY_SIMPLEX, 0.6, Scalar(255,255,255),1);
+        }
+    }
+
+    /**
+     * @brief Nearest-rank percentile of an already sorted sample.
+     */
+    static double percentile(const vector<double>& sorted, double p) {
+        if (sorted.empty()) return 0.0;
+        size_t idx = (size_t)ceil(p * sorted.size());
+        return sorted[min(sorted.size() - 1, idx == 0 ? 0 : idx - 1)];
+    }
+
+    /**
+     * @brief Route SIGINT/SIGTERM (and SIGUSR1 where available) to the global flags.
+     */
+    static void installSignalHandlers() {
+#ifndef _WIN32
+        // signal() would restart interrupted reads (SA_RESTART); a stop must
+        // interrupt them instead, so a stalled source cannot hold up shutdown.
+        auto install = [](int sig, void (*handler)(int), int flags) {
+            struct sigaction sa {};
+            sa.sa_handler = handler;
+            sa.sa_flags = flags;
+            sigemptyset(&sa.sa_mask);
+            sigaction(sig, &sa, nullptr);
+        };
+        install(SIGINT, [](int) { g_stop_requested.store(true); }, 0);
+        install(SIGTERM, [](int) { g_stop_requested.store(true); }, 0);
+        install(SIGUSR1, [](int) { g_dump_requested.store(true); }, SA_RESTART);
+#else
+        signal(SIGINT, [](int) { g_stop_requested.store(true); });
+        signal(SIGTERM, [](int) { g_stop_requested.store(true); });
+#endif
+    }
+
+    /**
+     * @brief Read a whole file into bytes.
+     */
+    static bool readFile(const string& path, vector<uchar>& bytes) {
+        ifstream in(path, ios::binary | ios::ate);
+        if (!in.is_open()) return false;
+        bytes.resize((size_t)in.tellg());
+        in.seekg(0);
+        return (bool)in.read(reinterpret_cast<char*>(bytes.data()), (streamsize)bytes.size());
+    }
+
     /**
      * @brief Check if a file extension corresponds to an image.
      */
@@ -282,17 +1202,39 @@ private:
     }
 
     /**
-     * @brief Detect and extract the largest face from an image.
+     * @brief Detect and extract the largest face from an encoded photo.
+     *
+     * Enrollment photos are far larger than face detection needs. The photo
+     * is decoded straight to grayscale at 1/2, 1/4 or 1/8 scale, chosen from
+     * the dimensions in its header so that the long side stays at least 1000
+     * pixels. The cascade runs on that image with its minimum face size
+     * scaled down to match. If the face covers fewer than 200x200 pixels
+     * there, only then is the photo decoded again, at the coarsest scale
+     * where it does not, and the face is cropped from that.
      */
-    Mat extractFace(const Mat& img) {
-        if(img.empty()) return Mat();
-        Mat gray;
-        cvtColor(img, gray, COLOR_BGR2GRAY);
+    static Mat extractFace(const vector<uchar>& bytes, CascadeClassifier& cascade) {
+        ImageHeader header;
+        int factor = ImageHeader::parse(bytes.data(), bytes.size(), header) ? header.reduction(1000) : 1;
+        Mat gray = imdecode(bytes, ImageHeader::grayFlag(factor));
+        if(gray.empty()) return Mat();
         vector<Rect> faces;
-        face_cascade.detectMultiScale(gray, faces, 1.1, 4, 0, Size(80,80));
+        int min_face = max(24, 80 / factor);
+        cascade.detectMultiScale(gray, faces, 1.1, 4, 0, Size(min_face, min_face));
         if(faces.empty()) return Mat();
         Rect best = *max_element(faces.begin(), faces.end(),
                                  [](const Rect& a, const Rect& b){ return a.area() < b.area(); });
+
+        int fine = factor;
+        while (fine > 1 && min(best.width, best.height) * factor / fine < 200) fine /= 2;
+        if (fine != factor) {
+            Mat detail = imdecode(bytes, ImageHeader::grayFlag(fine));
+            if (!detail.empty()) {
+                double s = (double)detail.cols / gray.cols;
+                Rect scaled(cvRound(best.x * s), cvRound(best.y * s), cvRound(best.width * s), cvRound(best.height * s));
+                best = scaled & Rect(0, 0, detail.cols, detail.rows);
+                gray = detail;
+            }
+        }
         Mat roi = gray(best);
         resize(roi, roi, Size(200,200));
         equalizeHist(roi, roi);
@@ -302,26 +1244,35 @@ private:
     /**
      * @brief Recognize a face by comparing with known faces using mean squared error.
      */
-    string recognizeFace(const Mat& face) {
-        string best_name = "Unknown";
-        double min_mse = DBL_MAX;
-
-        for(auto &kv : known_faces) {
-            Mat diff;
-            absdiff(face, kv.second, diff);
-            double mse = sum(diff.mul(diff))[0] / (200.0*200.0);
-            if(mse < min_mse && mse < 1500.0) {
-                min_mse = mse;
-                best_name = kv.first;
-            }
-        }
-        return best_name;
+    string recognizeFace(const Mat& face, const FaceGallery& gallery, SessionState& vs) {
+        // Trying the last match first gives early abandoning a tight bound.
+        int idx = gallery.match(face, nullptr, vs.last_match);
+        if (idx < 0) return "Unknown";
+        vs.last_match = idx;
+        return gallery.name(idx);
     }
 };
 
 // ----------------- Main Function -----------------
-int main() {
-    AttendanceSystem system;
+int main(int argc, char** argv) {
+    EngineConfig config;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--", 0) != 0 || i + 1 >= argc || !config.set(arg.substr(2), argv[i + 1])) {
+            cerr << "Usage: " << argv[0] << " [options]\n" << EngineConfig::usage();
+            return EXIT_FAILURE;
+        }
+        i++;
+    }
+
+    AttendanceSystem system(config);
+    if (!config.replay.empty())
+        return system.runReplay(config.replay) ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (!config.cameras.empty())
+        return system.runMultiCamera() ? EXIT_SUCCESS : EXIT_FAILURE;
+    if (config.headless)
+        return system.runHeadless() ? EXIT_SUCCESS : EXIT_FAILURE;
+
     int choice=0;
     do {
         cout << "\n==== Face Attendance ====\n";
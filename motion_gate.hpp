@@ -0,0 +1,68 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @class MotionGate
+ * @brief Cheap "did anything change?" test between consecutive frames.
+ *
+ * Each frame is shrunk to kWidth x kHeight gray and compared with the
+ * previous one; the mean absolute difference is the motion energy.
+ */
+class MotionGate {
+public:
+    static constexpr int kWidth = 64;
+    static constexpr int kHeight = 36;
+
+    /**
+     * @param threshold Mean absolute difference (0..255) counted as motion.
+     */
+    explicit MotionGate(double threshold = 0.0) : threshold(threshold) {}
+
+    /**
+     * @brief Feed the next BGR frame.
+     * @return true if it differs from the previous frame (always true for the first one).
+     */
+    bool update(const cv::Mat& frame) {
+        cv::resize(frame, small, cv::Size(kWidth, kHeight), 0, 0, cv::INTER_AREA);
+        cv::cvtColor(small, current, cv::COLOR_BGR2GRAY);
+
+        bool moved = true;
+        if (!previous.empty()) {
+            cv::absdiff(current, previous, diff);
+            last_energy = cv::sum(diff)[0] / (kWidth * kHeight);
+            moved = last_energy >= threshold;
+        }
+        cv::swap(current, previous);
+        return moved;
+    }
+
+    /**
+     * @brief Record whether the frame that was just gated got processed.
+     */
+    void count(bool skipped) {
+        frames.fetch_add(1, std::memory_order_relaxed);
+        if (skipped) frames_skipped.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    double energy() const { return last_energy; }
+    uint64_t seen() const { return frames.load(std::memory_order_relaxed); }
+    uint64_t skipped() const { return frames_skipped.load(std::memory_order_relaxed); }
+
+    void dump(std::ostream& os) const {
+        uint64_t n = seen(), k = skipped();
+        os << "[Stats] Motion gate: skipped " << k << " of " << n << " frames";
+        if (n) os << " (" << (100 * k / n) << "%)";
+        os << "\n";
+    }
+
+private:
+    double threshold;
+    cv::Mat small, current, previous, diff;   ///< Reused buffers, no allocation after the first frame
+    double last_energy = 0.0;
+    std::atomic<uint64_t> frames{0};            ///< Atomic: dump() may run on another thread
+    std::atomic<uint64_t> frames_skipped{0};
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @class PhotoWatcher
+ * @brief Calls back when files in the photos directory or its per-person
+ *        subdirectories are added, changed, renamed or deleted (inotify; Linux only).
+ *
+ * Events are debounced: the callback runs on the watcher's own thread once
+ * the directory has been quiet for kQuiet, so copying a batch of photos
+ * triggers one reload, not one per file. The callback gets the watcher's
+ * running flag, which is cleared when the watcher is destroyed, so a long
+ * reload can give up instead of holding up the destructor.
+ */
+class PhotoWatcher {
+public:
+    static constexpr std::chrono::milliseconds kQuiet{500};
+
+    PhotoWatcher(const std::string& dir, std::function<void(const std::atomic<bool>&)> on_change) : dir(dir), callback(std::move(on_change)) {
+#ifdef __linux__
+        fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (fd >= 0 && inotify_add_watch(fd, dir.c_str(), kMask | IN_CREATE) >= 0) {
+            watchSubdirs();
+            worker = std::thread([this] { run(); });
+            return;
+        }
+        std::cerr << "[Warn] Cannot watch " << dir << " for new photos" << std::endl;
+#else
+        std::cerr << "[Warn] Photo hot-reload needs inotify (Linux); " << dir << " is not watched" << std::endl;
+#endif
+    }
+
+    ~PhotoWatcher() {
+        running.store(false, std::memory_order_release);
+        if (worker.joinable()) worker.join();
+#ifdef __linux__
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    PhotoWatcher(const PhotoWatcher&) = delete;
+    PhotoWatcher& operator=(const PhotoWatcher&) = delete;
+
+    bool active() const { return worker.joinable(); }
+
+private:
+    std::string dir;
+    std::function<void(const std::atomic<bool>&)> callback;
+    std::atomic<bool> running{true};
+    std::thread worker;
+    int fd = -1;
+
+#ifdef __linux__
+    static constexpr uint32_t kMask = IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE;
+
+    /**
+     * @brief Watch every subdirectory (watching one twice is a no-op).
+     */
+    void watchSubdirs() {
+        std::error_code ec;
+        for (auto it = std::filesystem::directory_iterator(dir, ec); !ec && it != std::filesystem::directory_iterator();
+             it.increment(ec))
+            if (it->is_directory(ec)) inotify_add_watch(fd, it->path().c_str(), kMask);
+    }
+
+    void run() {
+        using Clock = std::chrono::steady_clock;
+        alignas(struct inotify_event) char buf[4096];
+        bool pending = false;
+        Clock::time_point last_event;
+        while (running.load(std::memory_order_acquire)) {
+            pollfd p{fd, POLLIN, 0};
+            if (poll(&p, 1, 100) > 0) {
+                while (read(fd, buf, sizeof(buf)) > 0) {}   // only "something changed" matters
+                watchSubdirs();                                // a new person's directory
+                pending = true;
+                last_event = Clock::now();
+            }
+            if (pending && Clock::now() - last_event >= kQuiet) {
+                pending = false;
+                callback(running);
+            }
+        }
+    }
+#endif
+};
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @class RecognitionCache
+ * @brief Reuses the recognized name of a track instead of scanning the gallery every frame.
+ *
+ * A cached name is valid for max_age frames of its track, as long as the
+ * face crop still looks the same. The check is a kSigSide x kSigSide
+ * area-averaged thumbnail, compared with the one taken at the last gallery
+ * scan by mean absolute difference. Entries of dead tracks are dropped.
+ */
+class RecognitionCache {
+public:
+    static constexpr int kSigSide = 8;
+
+    /**
+     * @param max_age Frames a result is used for, including the scan itself (1 = cache off).
+     * @param max_change Mean absolute thumbnail difference (0..255) that forces a new scan.
+     */
+    RecognitionCache(int max_age = 1, double max_change = 8.0) : max_age(max_age), max_change(max_change) {}
+
+    bool enabled() const { return max_age > 1; }
+
+    /**
+     * @brief Look up the cached name of track id for this frame's crop.
+     *        Unconfirmed tracks (id < 0) always miss.
+     * @return true (and name set) on a hit; on a miss call store() after scanning.
+     */
+    bool lookup(int id, const cv::Mat& crop, std::string& name) {
+        cv::resize(crop, sig, cv::Size(kSigSide, kSigSide), 0, 0, cv::INTER_AREA);
+        lookups.fetch_add(1, std::memory_order_relaxed);
+        auto it = id < 0 ? entries.end() : entries.find(id);
+        if (it != entries.end() && it->second.age < max_age) {
+            cv::absdiff(sig, it->second.sig, diff);
+            if (cv::sum(diff)[0] / (kSigSide * kSigSide) <= max_change) {
+                it->second.age++;
+                hits.fetch_add(1, std::memory_order_relaxed);
+                name = it->second.name;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /**
+     * @brief Remember the result of a gallery scan for the crop of the last lookup().
+     */
+    void store(int id, const std::string& name) {
+        if (id < 0) return;
+        Entry& e = entries[id];
+        e.name = name;
+        sig.copyTo(e.sig);
+        e.age = 1;
+    }
+
+    /**
+     * @brief Forget all results (e.g. after the gallery changed).
+     */
+    void clear() { entries.clear(); }
+
+    /**
+     * @brief Drop the entries of tracks that are not in live_ids.
+     */
+    void prune(const std::vector<int>& live_ids) {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if (std::find(live_ids.begin(), live_ids.end(), it->first) == live_ids.end())
+                it = entries.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    uint64_t lookupCount() const { return lookups.load(std::memory_order_relaxed); }
+    uint64_t hitCount() const { return hits.load(std::memory_order_relaxed); }
+
+    void dump(std::ostream& os) const {
+        uint64_t n = lookupCount(), k = hitCount();
+        os << "[Stats] Recognition cache: " << k << " hits of " << n << " lookups";
+        if (n) os << " (" << (100 * k / n) << "% gallery scans saved)";
+        os << "\n";
+    }
+
+private:
+    struct Entry {
+        std::string name;
+        cv::Mat sig;         ///< Thumbnail of the crop at the last scan
+        int age = 0;         ///< Frames this result has been used for
+    };
+
+    int max_age;
+    double max_change;
+    std::unordered_map<int, Entry> entries;
+    cv::Mat sig, diff;       ///< Reused buffers
+    std::atomic<uint64_t> lookups{0};       ///< Atomic: dump() may run on another thread
+    std::atomic<uint64_t> hits{0};
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <utility>
+
+/**
+ * @class SpscRing
+ * @brief Bounded lock-free ring buffer for exactly one producer and one consumer thread.
+ *
+ * Elements are moved in and out, so passing cv::Mat handles only moves the
+ * reference-counted header, never the pixels.
+ */
+template <class T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    /**
+     * @brief Move v into the ring if there is room (v is left untouched otherwise).
+     */
+    bool tryPush(T& v) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == Capacity) return false;
+        slots[t & (Capacity - 1)] = std::move(v);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Move the oldest element into out, if any.
+     */
+    bool tryPop(T& out) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire)) return false;
+        T& slot = slots[h & (Capacity - 1)];
+        out = std::move(slot);
+        slot = T();   // drop any resources still held by the slot
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Push, waiting while the ring is full.
+     * @return false if cancel was raised before there was room.
+     */
+    bool push(T&& v, const std::atomic<bool>& cancel) {
+        while (!tryPush(v)) {
+            if (cancel.load(std::memory_order_acquire)) return false;
+            backoff();
+        }
+        return true;
+    }
+
+    /**
+     * @brief Pop, waiting while the ring is empty.
+     * @return false once the producer is done and the ring is drained.
+     */
+    bool pop(T& out, const std::atomic<bool>& producer_done) {
+        while (!tryPop(out)) {
+            if (producer_done.load(std::memory_order_acquire)) return tryPop(out);
+            backoff();
+        }
+        return true;
+    }
+
+private:
+    std::array<T, Capacity> slots{};
+    alignas(64) std::atomic<size_t> head{0};   ///< Next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> tail{0};   ///< Next slot to push, written by the producer
+
+    static void backoff() { std::this_thread::sleep_for(std::chrono::microseconds(100)); }
+};
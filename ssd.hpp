@@ -0,0 +1,53 @@
+#pragma once
+
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Reference sum of squared differences of two u8 buffers.
+ */
+inline uint64_t squaredDiffSumScalar(const uchar* a, const uchar* b, size_t n) {
+    uint64_t acc = 0;
+    for (size_t i = 0; i < n; i++) {
+        int d = (int)a[i] - (int)b[i];
+        acc += (uint64_t)(d * d);
+    }
+    return acc;
+}
+
+/**
+ * @brief Single-pass sum of squared differences of two u8 buffers.
+ *
+ * Uses OpenCV universal intrinsics when available: |a-b| in u8, widened to
+ * u16 and squared-and-pair-summed into s32 lanes with v_dotprod. Lanes are
+ * flushed to a 64-bit total every kFlushIters iterations, which keeps the
+ * sum of all lanes below 2^32 even with 16 s32 lanes (AVX-512).
+ * Falls back to squaredDiffSumScalar otherwise and for the tail.
+ */
+inline uint64_t squaredDiffSum(const uchar* a, const uchar* b, size_t n) {
+    uint64_t total = 0;
+    size_t i = 0;
+#if CV_SIMD && !CV_SIMD_SCALABLE
+    const size_t lanes = (size_t)cv::v_uint8::nlanes;
+    const size_t kFlushIters = 1024;   // 1024 * 2 * 2 * 255^2 * 16 lanes < 2^32
+    while (i + lanes <= n) {
+        cv::v_int32 acc = cv::vx_setzero_s32();
+        size_t end = i + kFlushIters * lanes;
+        if (end > n) end = n;
+        for (; i + lanes <= end; i += lanes) {
+            cv::v_uint8 d = cv::v_absdiff(cv::vx_load(a + i), cv::vx_load(b + i));
+            cv::v_uint16 lo, hi;
+            cv::v_expand(d, lo, hi);
+            cv::v_int16 slo = cv::v_reinterpret_as_s16(lo);
+            cv::v_int16 shi = cv::v_reinterpret_as_s16(hi);
+            acc += cv::v_dotprod(slo, slo);
+            acc += cv::v_dotprod(shi, shi);
+        }
+        total += cv::v_reduce_sum(cv::v_reinterpret_as_u32(acc));
+    }
+    cv::vx_cleanup();
+#endif
+    return total + squaredDiffSumScalar(a + i, b + i, n - i);
+}
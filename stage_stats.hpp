@@ -0,0 +1,174 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <ostream>
+
+/**
+ * @class LatencyHistogram
+ * @brief Fixed-bucket latency histogram (microsecond resolution).
+ *
+ * Buckets are log-linear: four buckets per power of two, so the relative
+ * error of a reported percentile is at most 25%. Recording is a handful of
+ * relaxed atomic operations and never allocates. Counters are atomic so the
+ * histogram can be printed while pipeline threads keep recording; a
+ * snapshot taken that way may be off by the frames in flight.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kBuckets = 4 + 4 * 24;   ///< Covers 0 us .. ~1 min, last bucket is overflow
+
+    void record(uint64_t us) {
+        counts[bucketOf(us)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum_us.fetch_add(us, std::memory_order_relaxed);
+        uint64_t m = max_us.load(std::memory_order_relaxed);
+        while (us > m && !max_us.compare_exchange_weak(m, us, std::memory_order_relaxed)) {}
+    }
+
+    void reset() {
+        for (auto& c : counts) c.store(0, std::memory_order_relaxed);
+        total.store(0, std::memory_order_relaxed);
+        sum_us.store(0, std::memory_order_relaxed);
+        max_us.store(0, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return total.load(std::memory_order_relaxed); }
+    uint64_t max() const { return max_us.load(std::memory_order_relaxed); }
+    double mean() const {
+        uint64_t n = count();
+        return n ? (double)sum_us.load(std::memory_order_relaxed) / n : 0.0;
+    }
+
+    /**
+     * @brief Upper bound (us) of the bucket holding the p-th quantile,
+     *        clamped to the largest recorded value.
+     */
+    uint64_t percentile(double p) const {
+        std::array<uint64_t, kBuckets> snap;
+        uint64_t n = 0;
+        for (int i = 0; i < kBuckets; i++) n += snap[i] = counts[i].load(std::memory_order_relaxed);
+        if (n == 0) return 0;
+        uint64_t top = max();
+        uint64_t rank = (uint64_t)(p * n);
+        if (rank >= n) rank = n - 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < kBuckets; i++) {
+            seen += snap[i];
+            if (seen > rank)
+                return (i + 1 < kBuckets && lowerBound(i + 1) < top) ? lowerBound(i + 1) : top;
+        }
+        return top;
+    }
+
+private:
+    std::array<std::atomic<uint64_t>, kBuckets> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum_us{0};
+    std::atomic<uint64_t> max_us{0};
+
+    static int bucketOf(uint64_t us) {
+        if (us < 4) return (int)us;
+        int e = 0;
+        for (uint64_t v = us; v >>= 1;) e++;
+        int idx = 4 + (e - 2) * 4 + (int)((us >> (e - 2)) & 3);
+        return idx < kBuckets ? idx : kBuckets - 1;
+    }
+
+    static uint64_t lowerBound(int idx) {
+        if (idx < 4) return (uint64_t)idx;
+        int e = (idx - 4) / 4 + 2;
+        return (uint64_t)(4 + (idx - 4) % 4) << (e - 2);
+    }
+};
+
+/**
+ * @brief Stages of the per-frame attendance loop that are timed.
+ */
+enum class Stage {
+    Capture,
+    Motion,
+    Convert,
+    Equalize,
+    Detect,
+    Track,
+    Associate,
+    Resize,
+    Recognize,
+    Decision,
+    Draw,
+    Display,
+    Count
+};
+
+/**
+ * @class StageStats
+ * @brief One LatencyHistogram per Stage plus a scoped timer to feed them.
+ */
+class StageStats {
+public:
+    /**
+     * @brief Records the lifetime of the object into one stage's histogram.
+     */
+    class Scope {
+    public:
+        Scope(StageStats& s, Stage st)
+            : stats(s), stage(st), start(std::chrono::steady_clock::now()) {}
+        ~Scope() {
+            auto us = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count();
+            stats.record(stage, (uint64_t)us);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        StageStats& stats;
+        Stage stage;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    void record(Stage s, uint64_t us) { hist[(int)s].record(us); }
+    const LatencyHistogram& get(Stage s) const { return hist[(int)s]; }
+
+    void reset() {
+        for (auto& h : hist) h.reset();
+    }
+
+    static const char* name(Stage s) {
+        static const char* names[] = {"capture", "motion", "cvtColor", "equalizeHist", "detectMultiScale",
+                                      "track", "associate", "resize", "recognizeFace", "capture->decision", "draw", "imshow/waitKey"};
+        return names[(int)s];
+    }
+
+    /**
+     * @brief Print a table of count, mean, p50/p95/p99 and max per stage (ms).
+     */
+    void dump(std::ostream& os) const {
+        auto ms = [](double us) { return us / 1000.0; };
+        os << "\n[Stats] Per-stage latency (ms)\n";
+        os << "  " << std::left << std::setw(18) << "stage" << std::right
+           << std::setw(10) << "count" << std::setw(10) << "mean" << std::setw(10) << "p50"
+           << std::setw(10) << "p95" << std::setw(10) << "p99" << std::setw(10) << "max" << "\n";
+        auto flags = os.flags();
+        auto prec = os.precision();
+        os << std::fixed << std::setprecision(3);
+        for (int i = 0; i < (int)Stage::Count; i++) {
+            const LatencyHistogram& h = hist[i];
+            os << "  " << std::left << std::setw(18) << name((Stage)i) << std::right
+               << std::setw(10) << h.count() << std::setw(10) << ms(h.mean())
+               << std::setw(10) << ms((double)h.percentile(0.50))
+               << std::setw(10) << ms((double)h.percentile(0.95))
+               << std::setw(10) << ms((double)h.percentile(0.99))
+               << std::setw(10) << ms((double)h.max()) << "\n";
+        }
+        os.flags(flags);
+        os.precision(prec);
+    }
+
+private:
+    std::array<LatencyHistogram, (size_t)Stage::Count> hist{};
+};
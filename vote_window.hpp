@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @class VoteWindow
+ * @brief Per-frame recognition results of one track in a fixed ring buffer,
+ *        for k-of-n verification over a time window.
+ *
+ * Holds the last kCapacity votes; older ones are overwritten. No allocation
+ * after construction as long as names fit the small-string buffer.
+ */
+class VoteWindow {
+public:
+    using Clock = std::chrono::steady_clock;
+    static constexpr size_t kCapacity = 128;    ///< ~4 s at 30 fps
+
+    void add(Clock::time_point at, const std::string& name) {
+        Vote& v = votes[next];
+        v.at = at;
+        v.name = name;
+        next = (next + 1) % kCapacity;
+        if (count < kCapacity) count++;
+    }
+
+    void clear() { count = 0; }
+
+    /**
+     * @brief The name other than "Unknown" with the most votes in (now - window, now].
+     * @param votes_out Set to its vote count (0 if there is none).
+     * @return Empty string if no such vote.
+     */
+    std::string leader(Clock::time_point now, Clock::duration window, size_t& votes_out) const {
+        tally.clear();
+        for (size_t k = 0; k < count; k++) {
+            const Vote& v = votes[(next + kCapacity - 1 - k) % kCapacity];   // newest first
+            if (now - v.at >= window) break;
+            if (v.name == "Unknown") continue;
+            size_t j = 0;
+            while (j < tally.size() && tally[j].first != &v.name && *tally[j].first != v.name) j++;
+            if (j == tally.size()) tally.emplace_back(&v.name, 0);
+            tally[j].second++;
+        }
+        votes_out = 0;
+        const std::string* best = nullptr;
+        for (auto& t : tally) {
+            if (t.second > votes_out) {
+                votes_out = t.second;
+                best = t.first;
+            }
+        }
+        return best ? *best : std::string();
+    }
+
+private:
+    struct Vote {
+        Clock::time_point at;
+        std::string name;
+    };
+
+    std::array<Vote, kCapacity> votes{};
+    size_t next = 0;        ///< Slot of the next vote
+    size_t count = 0;       ///< Valid votes, <= kCapacity
+    mutable std::vector<std::pair<const std::string*, size_t>> tally;   ///< Reused per-name counts
+};